@@ -7,10 +7,27 @@
 #include "Utils/error.hpp"
 #include "Utils/strlib.hpp"
 #include "Utils/tokenScanner.hpp"
+#include "bytecode.hpp"
+#include "closedform.hpp"
+#include "constprop.hpp"
+#include "cppgen.hpp"
+#include "deadcode.hpp"
+#include "definite.hpp"
 #include "exp.hpp"
+#include "history.hpp"
+#include "jit.hpp"
+#include "loopdetect.hpp"
+#include "loopopt.hpp"
+#include "options.hpp"
 #include "parser.hpp"
+#include "partial.hpp"
+#include "plan.hpp"
+#include "profile.hpp"
 #include "program.hpp"
+#include "ranges.hpp"
+#include "region.hpp"
 #include "statement.hpp"
+#include "tripcount.hpp"
 #include <cctype>
 #include <iostream>
 #include <string>
@@ -19,9 +36,15 @@
 
 void processLine(std::string line, Program &program, EvalState &state);
 
+void reportFusionCounts();
+
 /* Main program */
 
-int main() {
+int main(int argc, char **argv) {
+  parseOptions(argc, argv);
+  if (options.fusionStats) {
+    atexit(reportFusionCounts);
+  }
   EvalState state;
   Program program;
   // cout << "Stub implementation of BASIC" << endl;
@@ -39,6 +62,18 @@ int main() {
   return 0;
 }
 
+/*
+ * Function: reportFusionCounts
+ * Usage: atexit(reportFusionCounts);
+ * ----------------------------------
+ * Writes the fused statement counts for --fusion-stats.  It runs at
+ * exit so that it covers both QUIT and the end of the input.
+ */
+
+void reportFusionCounts() {
+  printFusionCounts(std::cerr);
+}
+
 /*
  * Function: processLine
  * Usage: processLine(line, program, state);
@@ -54,7 +89,7 @@ int main() {
 bool isValidNumber(const std::string &input);
 
 void processLine(std::string line, Program &program, EvalState &state) {
-  // Support control sequence: LIST, RUN, CLEAR, QUIT, HELP
+  // Support control sequence: LIST, RUN, COMPILE, CHECK, CLEAR, QUIT, HELP
   if (line == "QUIT") {
     state.Clear();
     program.clear();
@@ -66,26 +101,76 @@ void processLine(std::string line, Program &program, EvalState &state) {
     std::cout << "Yet another basic interpreter" << std::endl;
   } else if (line == "LIST") {
     program.listAllLines();
+  } else if (line == "COMPILE") {
+    ExecutionPlan &plan = program.getPlan();
+    emitCpp(plan, std::cout);
+  } else if (line == "CHECK") {
+    ExecutionPlan &plan = program.getPlan();
+    TripCounts(program, plan).report(std::cout);
   } else if (line == "RUN") {
-    int firstLine = program.getFirstLineNumber();
-
-    int lineNumber = firstLine;
-    program.setCurrentLine(lineNumber);
-    while (lineNumber != -1) {
-      Statement *stmt = program.getParsedStatement(lineNumber);
-      if (stmt == nullptr) {
-        std::cout << "SYNTAX ERROR" << std::endl;
+    try {
+      ExecutionPlan &plan = program.getPlan();
+      if (options.reportRanges) {
+        program.getRanges(plan).report(std::cerr);
       }
-      try {
-        stmt->execute(state, program);
-      } catch (ErrorException &ex) {
-        std::cout << ex.getMessage() << std::endl;
-        break;
+      LoopDetector loopDetector;
+      LoopDetector *detector = nullptr;
+      if (options.detectLoops && LoopDetector::canWatch(plan)) {
+        detector = &loopDetector;
+      }
+      if (options.treeWalk) {
+        plan.run(state, program, 0, nullptr, nullptr, detector);
+      } else {
+        int step = plan.size() == 0 ? END_OF_PLAN : 0;
+        ExecutionHistory *history = nullptr;
+        if (options.tiering && options.history) {
+          history = &program.getHistory();
+        }
+        bool resumed = history != nullptr && history->resume(plan, state, step);
+        if (history != nullptr && !resumed) {
+          history->begin(plan, state);
+        }
+        OutputCapture capture(history);
+        if (options.partialEvaluation && !resumed) {
+          const PartialEvaluation &partial = program.getPartialEvaluation(plan);
+          if (history != nullptr) {
+            history->addPrefix(plan, partial, state);
+          }
+          partial.replay(state);
+          step = partial.getResumeStep();
+        }
+        if (options.tiering) {
+          while (step != END_OF_PLAN) {
+            step = plan.run(state, program, step, &program.getProfile(), history,
+                            detector);
+            if (step != END_OF_PLAN) {
+              CompiledRegion &region = program.getRegion(plan, step, state);
+              if (history != nullptr) {
+                history->enterRegion(plan, region.getFirstLine(), region.getLastLine(),
+                                     state);
+              }
+              int line = region.run(state, detector);
+              step = line == END_OF_PLAN ? END_OF_PLAN : plan.findStep(line);
+            }
+          }
+        }
+        if (step == END_OF_PLAN) {
+          return;
+        }
+        BytecodeProgram &code = program.getBytecode(plan, state);
+        int start = code.getEntry(step);
+        JitProgram *jit = options.jit ? program.getJit(plan, state) : nullptr;
+        if (jit != nullptr) {
+          jit->run(state, start);
+        } else if (options.jit) {
+          code.run(state, start);
+        } else {
+          code.run(state, start, detector);
+        }
       }
-      lineNumber = program.nextLine();
-      program.setCurrentLine(lineNumber);
+    } catch (ErrorException &ex) {
+      std::cout << ex.getMessage() << std::endl;
     }
-
   } else {
     TokenScanner scanner;
     scanner.ignoreWhitespace();
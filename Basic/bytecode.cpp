@@ -0,0 +1,491 @@
+/*
+ * File: bytecode.cpp
+ * ------------------
+ * This file implements the bytecode compiler and virtual machine
+ * declared in bytecode.h.
+ */
+
+#include "bytecode.hpp"
+#include "constprop.hpp"
+#include "deadcode.hpp"
+#include "definite.hpp"
+#include "loopopt.hpp"
+#include "ranges.hpp"
+#include "trace.hpp"
+#include "Utils/error.hpp"
+#include <iostream>
+
+/*
+ * Implementation notes: BytecodeProgram constructor
+ * -------------------------------------------------
+ * Steps are compiled in plan order, so falling off the end of one
+ * step simply continues with the code of the next.  Jumps are emitted
+ * against labels and patched once every label has an address.  Labels
+ * 0 to plan.size() - 1 are the steps, label plan.size() is the OP_END
+ * appended after the last step, and every optimized loop adds two
+ * ranges of labels for its two copies.
+ */
+
+BytecodeProgram::BytecodeProgram(const ExecutionPlan &plan, EvalState &state,
+                                 const ConstantPropagation *constants,
+                                 const LoopOptimizer *loops, const DeadCode *dead,
+                                 const DefiniteAssignment *definite,
+                                 const ValueRanges *ranges,
+                                 const ClosedForms *closedForms)
+        : constants(constants), dead(dead), definite(definite), ranges(ranges) {
+    endLabel = plan.size();
+    labels.assign(plan.size() + 1, 0);
+    entries.assign(plan.size(), 0);
+    for (int i = 0; i < plan.size(); i++) {
+        const CountingLoop *counting = closedForms == nullptr ? nullptr
+                                       : closedForms->findLoop(i);
+        if (counting != nullptr) {
+            compileClosedLoop(plan, *counting, state);
+            i = counting->latch;
+            continue;
+        }
+        const Loop *loop = loops == nullptr ? nullptr : loops->findLoop(i);
+        if (loop != nullptr) {
+            compileLoop(plan, *loop, state);
+            i = loop->latch;
+            continue;
+        }
+        labels[i] = code.size();
+        entries[i] = code.size();
+        compileStep(plan.getStep(i), state);
+    }
+    labels[endLabel] = code.size();
+    emit(OP_END);
+    for (auto &fixup : fixups) {
+        code[fixup.first].operand = labels[fixup.second];
+    }
+    fixups.clear();
+    hotness.assign(code.size(), 0);
+}
+
+BytecodeProgram::~BytecodeProgram() {
+    for (auto &entry : traces) {
+        delete entry.second;
+    }
+}
+
+void BytecodeProgram::setTracing(bool enabled) {
+    tracing = enabled;
+}
+
+void BytecodeProgram::compileStep(const PlanStep &step, EvalState &state) {
+    if (step.exit) {
+        emit(OP_EXIT, exitLines.size());
+        exitLines.push_back(step.exitLine);
+        return;
+    }
+    Statement *stmt = step.stmt;
+    if (stmt == nullptr || (dead != nullptr && dead->isDead(stmt))) return;
+    switch (stmt->getType()) {
+        case REM:
+            break;
+        case LET: {
+            LetStmt *let = (LetStmt *) stmt;
+            compileExp(let->getExp(), state);
+            emit(OP_STORE, state.getSlot(let->getVar()));
+            if (substituting == nullptr) break;
+            auto it = substituting->updates.find(stmt);
+            if (it == substituting->updates.end()) break;
+            for (int index : it->second) {
+                const HoistedValue &value = substituting->values[index];
+                int temp = state.getSlot(value.temp);
+                emit(OP_FETCH, temp);
+                if (value.stepTemp.empty()) {
+                    emit(OP_CONST, value.stepValue);
+                } else {
+                    emit(OP_FETCH, state.getSlot(value.stepTemp));
+                }
+                emit(OP_ADD);
+                emit(OP_STORE, temp);
+            }
+            break;
+        }
+        case PRINT:
+            compileExp(((PrintStmt *) stmt)->getExp(), state);
+            emit(OP_PRINT);
+            break;
+        case INPUT:
+            emit(OP_INPUT, state.getSlot(((InputStmt *) stmt)->getVar()));
+            break;
+        case GOTO:
+            if (step.badTarget) {
+                emitError("LINE NUMBER ERROR");
+                break;
+            }
+            compileJump(OP_JUMP, step.target);
+            break;
+        case IF: {
+            IfStmt *ifStmt = (IfStmt *) stmt;
+            if (step.badTarget) {
+                emitError("LINE NUMBER ERROR");
+                break;
+            }
+            compileExp(ifStmt->getLHS(), state);
+            compileExp(ifStmt->getRHS(), state);
+            std::string op = ifStmt->getOp();
+            OpCode jump = op == "=" ? OP_JUMP_EQ : op == "<" ? OP_JUMP_LT : OP_JUMP_GT;
+            compileJump(jump, step.target);
+            break;
+        }
+        case END:
+            emit(OP_END);
+            break;
+    }
+}
+
+/*
+ * Implementation notes: compileLoop
+ * ---------------------------------
+ * The code of an optimized loop starts with its guards, which jump to
+ * the original copy if any of them fails, and then computes the
+ * hoisted values into their hidden variables.  Outside jumps to the
+ * header land on the guards, so they are checked on every entry.
+ * Divisors are only loaded after the defined guards, and hidden
+ * variables only after they are set, so both are read with OP_FETCH.
+ */
+
+void BytecodeProgram::compileLoop(const ExecutionPlan &plan, const Loop &loop,
+                                  EvalState &state) {
+    int length = loop.latch - loop.header + 1;
+    labels[loop.header] = code.size();
+    int optimized = labels.size();
+    int original = optimized + length;
+    labels.resize(original + length, 0);
+    for (const std::string &var : loop.definedGuards) {
+        emit(OP_DEFINED, state.getSlot(var));
+        emit(OP_CONST, 0);
+        emitJump(OP_JUMP_EQ, original);
+    }
+    for (const std::string &var : loop.divisorGuards) {
+        int slot = state.getSlot(var);
+        emit(OP_FETCH, slot);
+        emit(OP_CONST, 0);
+        emitJump(OP_JUMP_EQ, original);
+        emit(OP_FETCH, slot);
+        emit(OP_CONST, -1);
+        emitJump(OP_JUMP_EQ, original);
+    }
+    for (const HoistedValue &value : loop.values) {
+        compileExp(value.exp, state);
+        emit(OP_STORE, state.getSlot(value.temp));
+        if (!value.stepTemp.empty()) {
+            emit(OP_CONST, value.step);
+            compileExp(value.factor, state);
+            emit(OP_MUL);
+            emit(OP_STORE, state.getSlot(value.stepTemp));
+        }
+    }
+    substituting = &loop;
+    compileCopy(plan, loop.header, loop.latch, optimized, state);
+    substituting = nullptr;
+    compileCopy(plan, loop.header, loop.latch, original, state);
+    entries[loop.header] = labels[loop.header];
+}
+
+/*
+ * Implementation notes: compileClosedLoop
+ * ---------------------------------------
+ * Only the OP_CLOSED sits at the header's label, so a loop entered
+ * from anywhere is tried in closed form once.  The loop's own code
+ * gets a second set of labels, and its back edge goes there.
+ */
+
+void BytecodeProgram::compileClosedLoop(const ExecutionPlan &plan, const CountingLoop &loop,
+                                        EvalState &state) {
+    labels[loop.header] = code.size();
+    emit(OP_CLOSED, closedLoops.size());
+    closedLoops.emplace_back(loop, state);
+    emit(OP_CONST, 1);
+    compileJump(OP_JUMP_EQ, plan.getStep(loop.latch).next);
+    int body = labels.size();
+    labels.resize(body + loop.latch - loop.header + 1, 0);
+    compileCopy(plan, loop.header, loop.latch, body, state);
+    entries[loop.header] = labels[loop.header];
+}
+
+/*
+ * Implementation notes: compileCopy
+ * ---------------------------------
+ * While a copy is compiled, jumps to steps of the loop go to the
+ * labels of that copy.  The optimized copy is followed by the original
+ * one, so falling off its end needs an explicit jump.  Only the
+ * original code can be entered in the middle of the loop, so its
+ * steps are the entries of the loop's steps.
+ */
+
+void BytecodeProgram::compileCopy(const ExecutionPlan &plan, int header, int latch, int base,
+                                  EvalState &state) {
+    copyBase = base;
+    copyHeader = header;
+    copyLatch = latch;
+    for (int i = header; i <= latch; i++) {
+        labels[base + i - header] = code.size();
+        if (substituting == nullptr) entries[i] = code.size();
+        compileStep(plan.getStep(i), state);
+    }
+    if (substituting != nullptr) compileJump(OP_JUMP, plan.getStep(latch).next);
+    copyBase = -1;
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Mirrors CompoundExp::eval: an assignment whose left side is not a
+ * plain variable raises SYNTAX ERROR when it is evaluated, before the
+ * right side runs.  The OP_CONST after such an error is unreachable
+ * and only keeps the operand stack balanced.  A node that constant
+ * propagation proved constant is replaced by its value.
+ */
+
+void BytecodeProgram::compileExp(Expression *exp, EvalState &state) {
+    int value;
+    if (constants != nullptr && constants->lookup(exp, value)) {
+        emit(OP_CONST, value);
+        return;
+    }
+    if (substituting != nullptr) {
+        auto it = substituting->uses.find(exp);
+        if (it != substituting->uses.end()) {
+            emit(OP_FETCH, state.getSlot(substituting->values[it->second].temp));
+            return;
+        }
+    }
+    switch (exp->getType()) {
+        case CONSTANT:
+            emit(OP_CONST, ((ConstantExp *) exp)->getValue());
+            break;
+        case IDENTIFIER:
+            emit(definite != nullptr && definite->isDefined(exp) ? OP_FETCH : OP_LOAD,
+                 state.getSlot(((IdentifierExp *) exp)->getName()));
+            break;
+        case COMPOUND: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            Expression *lhs = compound->getLHS();
+            if (op == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") {
+                    emitError("SYNTAX ERROR");
+                    emit(OP_CONST, 0);
+                    break;
+                }
+                compileExp(compound->getRHS(), state);
+                emit(OP_ASSIGN, state.getSlot(((IdentifierExp *) lhs)->getName()));
+                break;
+            }
+            compileExp(lhs, state);
+            compileExp(compound->getRHS(), state);
+            if (op == "+") emit(OP_ADD);
+            else if (op == "-") emit(OP_SUB);
+            else if (op == "*") emit(OP_MUL);
+            else if (ranges != nullptr && ranges->isSafeDivision(exp)) emit(OP_QUOT);
+            else emit(OP_DIV);
+            break;
+        }
+    }
+}
+
+void BytecodeProgram::compileJump(OpCode op, int target) {
+    int label = target == END_OF_PLAN ? endLabel : target;
+    if (copyBase != -1 && target >= copyHeader && target <= copyLatch) {
+        label = copyBase + target - copyHeader;
+    }
+    emitJump(op, label);
+}
+
+void BytecodeProgram::emitJump(OpCode op, int label) {
+    fixups.emplace_back(code.size(), label);
+    emit(op, label);
+}
+
+void BytecodeProgram::emit(OpCode op, int operand) {
+    code.push_back({op, operand});
+    depth += stackEffect(op);
+    if (depth > maxDepth) maxDepth = depth;
+}
+
+void BytecodeProgram::emitError(const std::string &message) {
+    emit(OP_ERROR, messages.size());
+    messages.push_back(message);
+}
+
+const std::vector<Instruction> &BytecodeProgram::getCode() const {
+    return code;
+}
+
+int BytecodeProgram::getEntry(int step) const {
+    return entries[step];
+}
+
+const ClosedLoop &BytecodeProgram::getClosedLoop(int index) const {
+    return closedLoops[index];
+}
+
+std::string BytecodeProgram::getMessage(int index) const {
+    return messages[index];
+}
+
+int BytecodeProgram::getExitLine(int index) const {
+    return exitLines[index];
+}
+
+int stackEffect(OpCode op) {
+    switch (op) {
+        case OP_CONST: case OP_LOAD: case OP_FETCH: case OP_DEFINED: case OP_CLOSED:
+            return 1;
+        case OP_STORE: case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+        case OP_QUOT: case OP_PRINT:
+            return -1;
+        case OP_JUMP_EQ: case OP_JUMP_LT: case OP_JUMP_GT:
+            return -2;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The interpreter loop keeps the program counter and the operand
+ * stack pointer in locals and dispatches with a single switch.  The
+ * stack is sized from the deepest expression seen by the compiler.
+ * Jumps are the only instructions that talk to the trace machinery:
+ * they report their outcome while an iteration is being recorded, and
+ * a backward jump hands its target to backEdge.
+ */
+
+int BytecodeProgram::run(EvalState &state, int start, LoopDetector *detector) {
+    this->detector = detector;
+    std::vector<int> stack(maxDepth + 1);
+    int *sp = stack.data();
+    const Instruction *base = code.data();
+    const Instruction *pc = base + start;
+    bool taken;
+    while (true) {
+        const Instruction &ins = *pc++;
+        switch (ins.op) {
+            case OP_CONST:
+                *sp++ = ins.operand;
+                break;
+            case OP_LOAD:
+                if (!state.isSlotDefined(ins.operand)) error("VARIABLE NOT DEFINED");
+                *sp++ = state.getSlotValue(ins.operand);
+                break;
+            case OP_FETCH:
+                *sp++ = state.getSlotValue(ins.operand);
+                break;
+            case OP_DEFINED:
+                *sp++ = state.isSlotDefined(ins.operand) ? 1 : 0;
+                break;
+            case OP_CLOSED:
+                state.touchAllSlots();
+                *sp++ = closedLoops[ins.operand].run(state.getValueArray(),
+                                                     state.getDefinedArray()) ? 1 : 0;
+                break;
+            case OP_STORE:
+                state.setSlotValue(ins.operand, *--sp);
+                break;
+            case OP_ASSIGN:
+                state.setSlotValue(ins.operand, sp[-1]);
+                break;
+            case OP_ADD:
+                sp--;
+                sp[-1] = sp[-1] + sp[0];
+                break;
+            case OP_SUB:
+                sp--;
+                sp[-1] = sp[-1] - sp[0];
+                break;
+            case OP_MUL:
+                sp--;
+                sp[-1] = sp[-1] * sp[0];
+                break;
+            case OP_DIV:
+                sp--;
+                if (sp[0] == 0) error("DIVIDE BY ZERO");
+                sp[-1] = sp[-1] / sp[0];
+                break;
+            case OP_QUOT:
+                sp--;
+                sp[-1] = sp[-1] / sp[0];
+                break;
+            case OP_JUMP:
+                if (recordHead != -1) recordBranch(&ins, true);
+                pc = base + ins.operand;
+                if (pc <= &ins) pc = backEdge(pc, state, stack.data());
+                break;
+            case OP_JUMP_EQ: case OP_JUMP_LT: case OP_JUMP_GT:
+                sp -= 2;
+                taken = ins.op == OP_JUMP_EQ ? sp[0] == sp[1]
+                        : ins.op == OP_JUMP_LT ? sp[0] < sp[1] : sp[0] > sp[1];
+                if (recordHead != -1) recordBranch(&ins, taken);
+                if (taken) {
+                    pc = base + ins.operand;
+                    if (pc <= &ins) pc = backEdge(pc, state, stack.data());
+                }
+                break;
+            case OP_PRINT:
+                std::cout << *--sp << std::endl;
+                break;
+            case OP_INPUT:
+                state.setSlotValue(ins.operand, InputStmt::readValue());
+                break;
+            case OP_END:
+                return END_OF_PLAN;
+            case OP_EXIT:
+                return exitLines[ins.operand];
+            case OP_ERROR:
+                error(messages[ins.operand]);
+                break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: backEdge
+ * ------------------------------
+ * Called with the target of every backward jump, which is also where
+ * the loop detector looks.  If an iteration is being recorded and it
+ * has come back to its head, the trace is compiled; a target whose
+ * recording fails is never recorded again, because its counter has
+ * already passed the threshold.  Traces are
+ * not entered while recording, so the recorded decisions describe one
+ * uninterrupted path.  The returned pointer is where the interpreter
+ * continues, which is the trace's exit when a trace ran.
+ */
+
+const Instruction *BytecodeProgram::backEdge(const Instruction *head, EvalState &state,
+                                             int *stack) {
+    int index = head - code.data();
+    if (detector != nullptr) detector->check(this, index, state);
+    if (recordHead != -1) {
+        if (index != recordHead) return head;
+        Trace *trace = new Trace(code, recordHead, decisions);
+        if (trace->isValid()) {
+            traces[recordHead] = trace;
+        } else {
+            delete trace;
+        }
+        recordHead = -1;
+        decisions.clear();
+    }
+    auto it = traces.find(index);
+    if (it != traces.end()) {
+        if (it->second->canEnter(state)) return code.data() + it->second->run(state, stack);
+        return head;
+    }
+    if (tracing && ++hotness[index] == TRACE_THRESHOLD) recordHead = index;
+    return head;
+}
+
+void BytecodeProgram::recordBranch(const Instruction *ins, bool taken) {
+    decisions.emplace_back(ins - code.data(), taken);
+    if (decisions.size() > (size_t) Trace::MAX_LENGTH) {
+        recordHead = -1;
+        decisions.clear();
+    }
+}
@@ -0,0 +1,267 @@
+/*
+ * File: bytecode.h
+ * ----------------
+ * This interface exports the BytecodeProgram class, which compiles a
+ * whole BASIC program into a flat array of stack-machine instructions
+ * and runs it on a small virtual machine.  RUN uses it in place of
+ * calling Statement::execute line by line.
+ */
+
+#ifndef _bytecode_h
+#define _bytecode_h
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "closedform.hpp"
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "loopdetect.hpp"
+#include "plan.hpp"
+#include "statement.hpp"
+
+/*
+ * Type: OpCode
+ * ------------
+ * The instruction set of the virtual machine.  Expressions are
+ * compiled into postfix order on an operand stack; variables are
+ * addressed by their EvalState slot.
+ *
+ *  OP_CONST     push the operand
+ *  OP_LOAD      push slot[operand], VARIABLE NOT DEFINED if unset
+ *  OP_FETCH     push slot[operand], which is known to be defined
+ *  OP_DEFINED   push 1 if slot[operand] is defined, else 0
+ *  OP_CLOSED    run closed loop operand, push 1 if it ran, else 0
+ *  OP_STORE     pop into slot[operand]
+ *  OP_ASSIGN    store the top of stack into slot[operand], keep it
+ *  OP_ADD ..    pop rhs and lhs, push lhs op rhs
+ *  OP_QUOT      pop rhs and lhs, push lhs / rhs, rhs known not to be 0
+ *  OP_JUMP      continue at instruction operand
+ *  OP_JUMP_EQ.. pop rhs and lhs, jump to operand if lhs op rhs
+ *  OP_PRINT     pop and print
+ *  OP_INPUT     read a number into slot[operand]
+ *  OP_END       stop the program
+ *  OP_EXIT      leave the compiled code through exit step operand
+ *  OP_ERROR     raise the message with index operand
+ */
+
+enum OpCode {
+    OP_CONST, OP_LOAD, OP_FETCH, OP_DEFINED, OP_CLOSED, OP_STORE, OP_ASSIGN,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_QUOT,
+    OP_JUMP, OP_JUMP_EQ, OP_JUMP_LT, OP_JUMP_GT,
+    OP_PRINT, OP_INPUT, OP_END, OP_EXIT, OP_ERROR
+};
+
+/*
+ * Type: Instruction
+ * -----------------
+ * A single virtual machine instruction: an opcode and one operand
+ * whose meaning depends on the opcode.
+ */
+
+struct Instruction {
+    OpCode op;
+    int operand;
+};
+
+class Trace;
+class ConstantPropagation;
+class LoopOptimizer;
+class DeadCode;
+class DefiniteAssignment;
+class ValueRanges;
+struct Loop;
+
+/*
+ * Function: stackEffect
+ * Usage: depth += stackEffect(op);
+ * --------------------------------
+ * Returns the net change in operand stack depth caused by executing
+ * an instruction with the given opcode.
+ */
+
+int stackEffect(OpCode op);
+
+/*
+ * Class: BytecodeProgram
+ * ----------------------
+ * This class holds the compiled form of a program.  The slots used by
+ * the instructions belong to the EvalState passed to the constructor,
+ * so the same state must be passed to run.
+ *
+ * While running, the VM counts how often each backward jump lands on
+ * its target.  A target that gets hot has one loop iteration recorded
+ * and compiled into a Trace (see trace.h), which later iterations run
+ * instead of the general interpreter loop.
+ */
+
+class BytecodeProgram {
+
+public:
+
+/*
+ * Constructor: BytecodeProgram
+ * Usage: BytecodeProgram code(plan, state);
+ *        BytecodeProgram code(plan, state, &constants, &loops, &dead, &definite,
+ *                             &ranges, &closedForms);
+ * ------------------------------------------------------------------------------
+ * Compiles every step of a linked program.  Jump targets are turned
+ * from step indices into instruction indices here.  If constants is
+ * given, every expression it lists compiles to a single OP_CONST.  If
+ * loops is given, each loop it optimizes is compiled twice: a copy
+ * that reads the hoisted values from hidden variables, entered when
+ * the loop's guards hold, and the original code otherwise.  If dead
+ * is given, the statements it lists compile to nothing.  If definite
+ * is given, the reads it proves safe compile to OP_FETCH, and if ranges
+ * is given, the divisions it proves safe compile to OP_QUOT.  If
+ * closedForms is given, each counting loop it finds starts with an
+ * OP_CLOSED that leaves the loop at once when it can, followed by the
+ * loop's own code for when it cannot.
+ */
+
+    BytecodeProgram(const ExecutionPlan &plan, EvalState &state,
+                    const ConstantPropagation *constants = nullptr,
+                    const LoopOptimizer *loops = nullptr,
+                    const DeadCode *dead = nullptr,
+                    const DefiniteAssignment *definite = nullptr,
+                    const ValueRanges *ranges = nullptr,
+                    const ClosedForms *closedForms = nullptr);
+
+/*
+ * Destructor: ~BytecodeProgram
+ * Usage: usually implicit
+ * -----------------------
+ * Frees the compiled loop traces.
+ */
+
+    ~BytecodeProgram();
+
+    BytecodeProgram(const BytecodeProgram &) = delete;
+    BytecodeProgram &operator=(const BytecodeProgram &) = delete;
+
+/*
+ * Method: run
+ * Usage: code.run(state);
+ *        int line = code.run(state, code.getEntry(step));
+ * -------------------------------------------------------
+ * Runs the compiled program from its first line, or from the given
+ * instruction.  Returns END_OF_PLAN when the program ends, or the line
+ * of the exit step through which control left a region plan.  Runtime
+ * errors are raised with error() exactly as Statement::execute would
+ * raise them.  If a detector is given, it sees every backward jump
+ * the interpreter takes; traces take jumps of their own, so tracing
+ * should be off.
+ */
+
+    int run(EvalState &state, int start = 0, LoopDetector *detector = nullptr);
+
+/*
+ * Method: getEntry
+ * Usage: int start = code.getEntry(step);
+ * ---------------------------------------
+ * Returns the instruction at which running from the given step of the
+ * plan begins.  The operand stack is empty there.
+ */
+
+    int getEntry(int step) const;
+
+/*
+ * Method: setTracing
+ * Usage: code.setTracing(false);
+ * ------------------------------
+ * Turns the recording and use of loop traces on or off.  Tracing is
+ * on by default.
+ */
+
+    void setTracing(bool enabled);
+
+/*
+ * Constant: TRACE_THRESHOLD
+ * -------------------------
+ * The number of backward jumps to a target after which the next loop
+ * iteration starting there is recorded.
+ */
+
+    static const int TRACE_THRESHOLD = 50;
+
+/*
+ * Method: getCode
+ * Usage: const std::vector<Instruction> &code = bytecode.getCode();
+ * -----------------------------------------------------------------
+ * Returns the compiled instructions.
+ */
+
+    const std::vector<Instruction> &getCode() const;
+
+/*
+ * Method: getClosedLoop
+ * Usage: const ClosedLoop &closed = code.getClosedLoop(index);
+ * ------------------------------------------------------------
+ * Returns the closed loop referenced by an OP_CLOSED operand.
+ */
+
+    const ClosedLoop &getClosedLoop(int index) const;
+
+/*
+ * Method: getMessage
+ * Usage: std::string msg = code.getMessage(index);
+ * ------------------------------------------------
+ * Returns the error message referenced by an OP_ERROR operand.
+ */
+
+    std::string getMessage(int index) const;
+
+/*
+ * Method: getExitLine
+ * Usage: int line = code.getExitLine(index);
+ * ------------------------------------------
+ * Returns the line of the exit step referenced by an OP_EXIT operand.
+ */
+
+    int getExitLine(int index) const;
+
+private:
+
+    void compileStep(const PlanStep &step, EvalState &state);
+    void compileLoop(const ExecutionPlan &plan, const Loop &loop, EvalState &state);
+    void compileClosedLoop(const ExecutionPlan &plan, const CountingLoop &loop,
+                           EvalState &state);
+    void compileCopy(const ExecutionPlan &plan, int header, int latch, int base,
+                     EvalState &state);
+    void compileExp(Expression *exp, EvalState &state);
+    void compileJump(OpCode op, int target);
+    void emitJump(OpCode op, int label);
+    void emit(OpCode op, int operand = 0);
+    void emitError(const std::string &message);
+    const Instruction *backEdge(const Instruction *head, EvalState &state, int *stack);
+    void recordBranch(const Instruction *ins, bool taken);
+
+    const ConstantPropagation *constants;
+    const DeadCode *dead;
+    const DefiniteAssignment *definite;
+    const ValueRanges *ranges;
+    const Loop *substituting = nullptr;
+    int copyBase = -1;
+    int copyHeader = 0;
+    int copyLatch = 0;
+    int endLabel = 0;
+    std::vector<Instruction> code;
+    std::vector<std::string> messages;
+    std::vector<int> exitLines;
+    std::vector<ClosedLoop> closedLoops;
+    std::vector<int> labels;
+    std::vector<int> entries;
+    std::vector<std::pair<int, int>> fixups;
+    int depth = 0;
+    int maxDepth = 0;
+    bool tracing = true;
+    std::vector<int> hotness;
+    std::unordered_map<int, Trace *> traces;
+    int recordHead = -1;
+    std::vector<std::pair<int, bool>> decisions;
+    LoopDetector *detector = nullptr;
+
+};
+
+#endif
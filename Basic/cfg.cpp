@@ -0,0 +1,245 @@
+/*
+ * File: cfg.cpp
+ * -------------
+ * This file implements the ControlFlowGraph class.
+ */
+
+#include "cfg.hpp"
+#include <algorithm>
+#include <utility>
+
+/*
+ * Implementation notes: ControlFlowGraph constructor
+ * --------------------------------------------------
+ * The predecessors are kept in compressed arrays, which the dominator
+ * and loop passes walk without any further allocation.
+ */
+
+ControlFlowGraph::ControlFlowGraph(const ExecutionPlan &plan) {
+    findPredecessors(plan);
+    findDominators(plan);
+    findLoops();
+}
+
+void ControlFlowGraph::findPredecessors(const ExecutionPlan &plan) {
+    int count = plan.getBlockCount();
+    predecessorStart.assign(count + 1, 0);
+    for (int i = 0; i < count; i++) {
+        for (int successor : plan.getBlock(i).successors) predecessorStart[successor + 1]++;
+    }
+    for (int i = 0; i < count; i++) predecessorStart[i + 1] += predecessorStart[i];
+    predecessorList.resize(predecessorStart[count]);
+    std::vector<int> fill(predecessorStart.begin(), predecessorStart.end() - 1);
+    for (int i = 0; i < count; i++) {
+        for (int successor : plan.getBlock(i).successors) {
+            predecessorList[fill[successor]++] = i;
+        }
+    }
+}
+
+int ControlFlowGraph::getPredecessorCount(int block) const {
+    return predecessorStart[block + 1] - predecessorStart[block];
+}
+
+int ControlFlowGraph::getPredecessor(int block, int index) const {
+    return predecessorList[predecessorStart[block] + index];
+}
+
+bool ControlFlowGraph::isReachable(int block) const {
+    return preorder[block] != -1;
+}
+
+int ControlFlowGraph::getImmediateDominator(int block) const {
+    return block == 0 ? -1 : idom[block];
+}
+
+bool ControlFlowGraph::dominates(int a, int b) const {
+    return dominatesIndex(a, b);
+}
+
+const std::vector<CFGLoop> &ControlFlowGraph::getLoops() const {
+    return loops;
+}
+
+const CFGLoop *ControlFlowGraph::findLoop(int header) const {
+    auto it = loopIndex.find(header);
+    return it == loopIndex.end() ? nullptr : &loops[it->second];
+}
+
+int ControlFlowGraph::getLoopHeader(int block) const {
+    return loopOf[block] == -1 ? -1 : loops[loopOf[block]].header;
+}
+
+int ControlFlowGraph::getLoopDepth(int block) const {
+    return loopOf[block] == -1 ? 0 : loops[loopOf[block]].depth;
+}
+
+/*
+ * Implementation notes: findDominators
+ * ------------------------------------
+ * The iterative algorithm of Cooper, Harvey and Kennedy: blocks are
+ * visited in reverse postorder and each block's dominator is the
+ * nearest common ancestor of its processed predecessors, until nothing
+ * changes.  Structured programs settle in two passes.  The dominator
+ * tree is then numbered in preorder and postorder so that dominates
+ * is a constant-time interval test.  Both walks use explicit stacks,
+ * since a long chain of blocks would overflow the native one.
+ */
+
+void ControlFlowGraph::findDominators(const ExecutionPlan &plan) {
+    int count = plan.getBlockCount();
+    idom.assign(count, -1);
+    preorder.assign(count, -1);
+    postorder.assign(count, -1);
+    if (count == 0) return;
+
+    std::vector<int> order, rpoNumber(count, -1);
+    std::vector<std::pair<int, int>> stack;
+    std::vector<char> visited(count, false);
+    visited[0] = true;
+    stack.emplace_back(0, 0);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        const std::vector<int> &successors = plan.getBlock(top.first).successors;
+        if (top.second < (int) successors.size()) {
+            int next = successors[top.second++];
+            if (!visited[next]) {
+                visited[next] = true;
+                stack.emplace_back(next, 0);
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); i++) rpoNumber[order[i]] = i;
+
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); i++) {
+            int block = order[i];
+            int dominator = -1;
+            for (int e = predecessorStart[block]; e < predecessorStart[block + 1]; e++) {
+                int pred = predecessorList[e];
+                if (idom[pred] == -1) continue;
+                if (dominator == -1) {
+                    dominator = pred;
+                    continue;
+                }
+                int a = pred, b = dominator;
+                while (a != b) {
+                    while (rpoNumber[a] > rpoNumber[b]) a = idom[a];
+                    while (rpoNumber[b] > rpoNumber[a]) b = idom[b];
+                }
+                dominator = a;
+            }
+            if (idom[block] != dominator) {
+                idom[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<int> childStart(count + 1, 0), children(order.size());
+    for (int block : order) {
+        if (block != 0) childStart[idom[block] + 1]++;
+    }
+    for (int i = 0; i < count; i++) childStart[i + 1] += childStart[i];
+    std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+    for (int block : order) {
+        if (block != 0) children[fill[idom[block]]++] = block;
+    }
+    int pre = 0, post = 0;
+    preorder[0] = pre++;
+    stack.emplace_back(0, childStart[0]);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < childStart[top.first + 1]) {
+            int child = children[top.second++];
+            preorder[child] = pre++;
+            stack.emplace_back(child, childStart[child]);
+        } else {
+            postorder[top.first] = post++;
+            stack.pop_back();
+        }
+    }
+}
+
+bool ControlFlowGraph::dominatesIndex(int a, int b) const {
+    return preorder[a] != -1 && preorder[b] != -1
+           && preorder[a] <= preorder[b] && postorder[b] <= postorder[a];
+}
+
+/*
+ * Implementation notes: findLoops
+ * -------------------------------
+ * A header is the target of an edge from a block it dominates.
+ * Headers are taken in dominator tree postorder, so inner loops come
+ * first.  Each loop body is found by walking backwards from its
+ * latches; a block that already belongs to a loop stands for the
+ * outermost loop found so far around it, which becomes a child of the
+ * current loop, and the walk continues from that loop's header.
+ */
+
+void ControlFlowGraph::findLoops() {
+    int count = idom.size();
+    loopOf.assign(count, -1);
+    loops.clear();
+    loopIndex.clear();
+    std::vector<int> headers;
+    for (int i = 0; i < count; i++) {
+        for (int e = predecessorStart[i]; e < predecessorStart[i + 1]; e++) {
+            if (dominatesIndex(i, predecessorList[e])) {
+                headers.push_back(i);
+                break;
+            }
+        }
+    }
+    std::sort(headers.begin(), headers.end(), [this](int a, int b) {
+        return postorder[a] < postorder[b];
+    });
+
+    std::vector<int> parent, headerOf, worklist;
+    for (int header : headers) {
+        int loop = loops.size();
+        loops.push_back({header, -1, 0, {}});
+        parent.push_back(-1);
+        headerOf.push_back(header);
+        loopIndex[header] = loop;
+        loopOf[header] = loop;
+        for (int e = predecessorStart[header]; e < predecessorStart[header + 1]; e++) {
+            int pred = predecessorList[e];
+            if (!dominatesIndex(header, pred)) continue;
+            loops[loop].latches.push_back(pred);
+            if (pred != header) worklist.push_back(pred);
+        }
+        while (!worklist.empty()) {
+            int block = worklist.back();
+            worklist.pop_back();
+            if (loopOf[block] == -1) {
+                loopOf[block] = loop;
+            } else {
+                int inner = loopOf[block];
+                while (parent[inner] != -1) inner = parent[inner];
+                if (inner == loop) continue;
+                parent[inner] = loop;
+                block = headerOf[inner];
+            }
+            for (int e = predecessorStart[block]; e < predecessorStart[block + 1]; e++) {
+                int pred = predecessorList[e];
+                if (preorder[pred] != -1) worklist.push_back(pred);
+            }
+        }
+    }
+    for (int loop = loops.size() - 1; loop >= 0; loop--) {
+        if (parent[loop] == -1) {
+            loops[loop].depth = 1;
+        } else {
+            loops[loop].parent = loops[parent[loop]].header;
+            loops[loop].depth = loops[parent[loop]].depth + 1;
+        }
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * File: cfg.h
+ * -----------
+ * This interface exports the ControlFlowGraph class, which adds the
+ * predecessors, dominators and loop nesting of the basic blocks of an
+ * ExecutionPlan to the successors the plan already records.
+ */
+
+#ifndef _cfg_h
+#define _cfg_h
+
+#include <unordered_map>
+#include <vector>
+#include "plan.hpp"
+
+/*
+ * Type: CFGLoop
+ * -------------
+ * A natural loop: header dominates every block of the loop, and
+ * latches are the blocks whose edge back to header closes it.  parent
+ * is the header of the innermost enclosing loop, or -1, and depth is
+ * 1 for an outermost loop.  Blocks are named by their index in the
+ * plan.  A cycle that can be entered at more than one block has no
+ * header that dominates it and is not reported.
+ */
+
+struct CFGLoop {
+    int header;
+    int parent;
+    int depth;
+    std::vector<int> latches;
+};
+
+/*
+ * Class: ControlFlowGraph
+ * -----------------------
+ * The graph is computed for the whole plan at once, in time linear in
+ * the number of edges for the usual programs.  ExecutionPlan builds it
+ * the first time getControlFlowGraph is called after the plan changed,
+ * and every analysis of the plan shares it, so the analyses that need
+ * predecessors, reachability or loops do not each work them out again.
+ * The plan is patched rather than rebuilt after an edit (see
+ * ExecutionPlan::update), so nothing here walks the Program itself.
+ */
+
+class ControlFlowGraph {
+
+public:
+
+/*
+ * Constructor: ControlFlowGraph
+ * Usage: ControlFlowGraph cfg(plan);
+ * ----------------------------------
+ * Analyzes the blocks of plan.  The entry block, where RUN starts, is
+ * block 0.
+ */
+
+    explicit ControlFlowGraph(const ExecutionPlan &plan);
+
+/*
+ * Methods: getPredecessorCount, getPredecessor
+ * Usage: for (int i = 0; i < cfg.getPredecessorCount(block); i++) . . .
+ * ---------------------------------------------------------------------
+ * Give read access to the blocks that have block among their
+ * successors, reachable or not.
+ */
+
+    int getPredecessorCount(int block) const;
+
+    int getPredecessor(int block, int index) const;
+
+/*
+ * Method: isReachable
+ * Usage: if (cfg.isReachable(block)) . . .
+ * ----------------------------------------
+ * Returns true if some path from the entry block reaches the block.
+ */
+
+    bool isReachable(int block) const;
+
+/*
+ * Method: getImmediateDominator
+ * Usage: int idom = cfg.getImmediateDominator(block);
+ * ---------------------------------------------------
+ * Returns the block's immediate dominator, or -1 for the entry block
+ * and for unreachable blocks.
+ */
+
+    int getImmediateDominator(int block) const;
+
+/*
+ * Method: dominates
+ * Usage: if (cfg.dominates(a, b)) . . .
+ * -------------------------------------
+ * Returns true if every path from the entry to block b passes through
+ * block a.  A block dominates itself; an unreachable block neither
+ * dominates nor is dominated.
+ */
+
+    bool dominates(int a, int b) const;
+
+/*
+ * Method: getLoops
+ * Usage: for (const CFGLoop &loop : cfg.getLoops()) . . .
+ * -------------------------------------------------------
+ * Returns every loop, inner loops before the loops containing them.
+ */
+
+    const std::vector<CFGLoop> &getLoops() const;
+
+/*
+ * Method: findLoop
+ * Usage: const CFGLoop *loop = cfg.findLoop(header);
+ * --------------------------------------------------
+ * Returns the loop with the given header, or nullptr.
+ */
+
+    const CFGLoop *findLoop(int header) const;
+
+/*
+ * Method: getLoopHeader
+ * Usage: int header = cfg.getLoopHeader(block);
+ * ---------------------------------------------
+ * Returns the header of the innermost loop containing the block, or
+ * -1 if it is in no loop.
+ */
+
+    int getLoopHeader(int block) const;
+
+/*
+ * Method: getLoopDepth
+ * Usage: int depth = cfg.getLoopDepth(block);
+ * -------------------------------------------
+ * Returns the number of loops containing the block.
+ */
+
+    int getLoopDepth(int block) const;
+
+private:
+
+    void findPredecessors(const ExecutionPlan &plan);
+    void findDominators(const ExecutionPlan &plan);
+    void findLoops();
+    bool dominatesIndex(int a, int b) const;
+
+    std::vector<int> predecessorStart, predecessorList;
+    std::vector<int> idom;
+    std::vector<int> preorder, postorder;
+    std::vector<int> loopOf;
+    std::vector<CFGLoop> loops;
+    std::unordered_map<int, int> loopIndex;
+
+};
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ * File: closedform.cpp
+ * --------------------
+ * This file implements the ClosedForms and ClosedLoop classes.
+ */
+
+#include "closedform.hpp"
+#include "cfg.hpp"
+#include <algorithm>
+#include <climits>
+#include <set>
+
+namespace {
+
+/*
+ * Function: binomial
+ * Usage: unsigned c = binomial(n, m);
+ * -----------------------------------
+ * Returns n choose m modulo 2^32.  The falling product n (n-1) ...
+ * (n-m+1) is a multiple of m!, so it is formed modulo m! * 2^32 and
+ * only then divided by m!.  For m up to MAX_DEGREE + 1 the modulus is
+ * below 2^39, so every partial product fits in 128 bits.
+ */
+
+unsigned binomial(long long n, int m) {
+    if (n < m) return 0;
+    unsigned long long factorial = 1;
+    for (int j = 2; j <= m; j++) factorial *= j;
+    unsigned __int128 modulus = (unsigned __int128) factorial << 32;
+    unsigned __int128 product = 1;
+    for (int j = 0; j < m; j++) {
+        product = product * (unsigned long long) (n - j) % modulus;
+    }
+    return (unsigned) (product / factorial);
+}
+
+/*
+ * Function: findTerms
+ * Usage: findTerms(exp, var, true, self, count);
+ * ----------------------------------------------
+ * Counts the terms of the sum exp that read var, following + and -
+ * from the top, and sets self to the last one that is added.  Reads of
+ * var anywhere else are left for degreeOf to reject.
+ */
+
+void findTerms(Expression *exp, const std::string &var, bool added, Expression *&self,
+               int &count) {
+    if (exp->getType() == IDENTIFIER && exp->toString() == var) {
+        count++;
+        if (added) self = exp;
+    } else if (exp->getType() == COMPOUND) {
+        CompoundExp *compound = (CompoundExp *) exp;
+        std::string op = compound->getOp();
+        if (op != "+" && op != "-") return;
+        findTerms(compound->getLHS(), var, added, self, count);
+        findTerms(compound->getRHS(), var, op == "+" ? added : !added, self, count);
+    }
+}
+
+/*
+ * Function: degreeOf
+ * Usage: int degree = degreeOf(exp, induction, self, assigned);
+ * -------------------------------------------------------------
+ * Returns the degree of exp as a polynomial in induction, reading self
+ * as 0, or -1 if it is not one or reads a variable in assigned other
+ * than induction.
+ */
+
+int degreeOf(Expression *exp, const std::string &induction, Expression *self,
+             const std::set<std::string> &assigned) {
+    if (exp == self) return 0;
+    switch (exp->getType()) {
+        case CONSTANT:
+            return 0;
+        case IDENTIFIER: {
+            std::string name = exp->toString();
+            if (name == induction) return 1;
+            return assigned.count(name) ? -1 : 0;
+        }
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            if (op != "+" && op != "-" && op != "*") return -1;
+            int left = degreeOf(compound->getLHS(), induction, self, assigned);
+            int right = degreeOf(compound->getRHS(), induction, self, assigned);
+            if (left < 0 || right < 0) return -1;
+            return op == "*" ? left + right : std::max(left, right);
+        }
+    }
+}
+
+}
+
+bool stepOf(Expression *exp, const std::string &var, int &step) {
+    if (exp->getType() != COMPOUND) return false;
+    CompoundExp *compound = (CompoundExp *) exp;
+    std::string op = compound->getOp();
+    Expression *lhs = compound->getLHS(), *rhs = compound->getRHS();
+    bool left = lhs->getType() == IDENTIFIER && lhs->toString() == var;
+    bool right = rhs->getType() == IDENTIFIER && rhs->toString() == var;
+    if (op == "+" && left && rhs->getType() == CONSTANT) {
+        step = ((ConstantExp *) rhs)->getValue();
+    } else if (op == "+" && right && lhs->getType() == CONSTANT) {
+        step = ((ConstantExp *) lhs)->getValue();
+    } else if (op == "-" && left && rhs->getType() == CONSTANT
+               && ((ConstantExp *) rhs)->getValue() != INT_MIN) {
+        step = -((ConstantExp *) rhs)->getValue();
+    } else {
+        return false;
+    }
+    return step != 0;
+}
+
+/*
+ * Implementation notes: ClosedForms constructor
+ * ---------------------------------------------
+ * A counting loop is a loop of the ControlFlowGraph whose header block
+ * is one of its own latches.
+ */
+
+ClosedForms::ClosedForms(const ExecutionPlan &plan) {
+    for (const CFGLoop &loop : plan.getControlFlowGraph().getLoops()) {
+        const std::vector<int> &latches = loop.latches;
+        if (std::find(latches.begin(), latches.end(), loop.header) != latches.end()) {
+            analyze(plan, loop.header);
+        }
+    }
+}
+
+/*
+ * Implementation notes: analyze
+ * -----------------------------
+ * The IF names the induction variable: it is the side of the
+ * comparison that the block assigns.  The LETs are then matched in
+ * order, so each update knows whether the induction step has already
+ * run when it is evaluated.  Every variable may be assigned only once,
+ * which keeps each update a function of the induction variable alone.
+ */
+
+void ClosedForms::analyze(const ExecutionPlan &plan, int block) {
+    const BasicBlock &range = plan.getBlock(block);
+    const PlanStep &last = plan.getStep(range.last);
+    if (last.stmt == nullptr || last.stmt->getType() != IF || last.badTarget
+        || last.target != range.first) {
+        return;
+    }
+    std::set<std::string> assigned;
+    for (int i = range.first; i < range.last; i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr || stmt->getType() == REM) continue;
+        if (stmt->getType() != LET) return;
+        if (!assigned.insert(((LetStmt *) stmt)->getVar()).second) return;
+    }
+
+    IfStmt *ifStmt = (IfStmt *) last.stmt;
+    Expression *lhs = ifStmt->getLHS(), *rhs = ifStmt->getRHS();
+    char op = ifStmt->getOp()[0];
+    if (op == '=') return;
+    CountingLoop loop;
+    loop.header = range.first;
+    loop.latch = range.last;
+    if (lhs->getType() == IDENTIFIER && assigned.count(lhs->toString())) {
+        loop.induction = lhs->toString();
+        loop.limit = rhs;
+    } else if (rhs->getType() == IDENTIFIER && assigned.count(rhs->toString())) {
+        loop.induction = rhs->toString();
+        loop.limit = lhs;
+        op = op == '<' ? '>' : '<';
+    } else {
+        return;
+    }
+    if (loop.limit->getType() == COMPOUND
+        || (loop.limit->getType() == IDENTIFIER && assigned.count(loop.limit->toString()))) {
+        return;
+    }
+
+    bool stepped = false;
+    for (int i = range.first; i < range.last; i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr || stmt->getType() == REM) continue;
+        LetStmt *let = (LetStmt *) stmt;
+        Expression *exp = let->getExp();
+        if (let->getVar() == loop.induction) {
+            if (!stepOf(exp, loop.induction, loop.step)) return;
+            stepped = true;
+            continue;
+        }
+        ClosedUpdate update = {let->getVar(), exp, nullptr, stepped, 0};
+        int count = 0;
+        findTerms(exp, update.var, true, update.self, count);
+        if (count != 1) update.self = nullptr;
+        update.degree = degreeOf(exp, loop.induction, update.self, assigned);
+        if (update.degree < 0 || update.degree > MAX_DEGREE) return;
+        loop.updates.push_back(update);
+    }
+    if (!stepped || (op == '<') != (loop.step > 0)) return;
+    loops.emplace(loop.header, loop);
+}
+
+const CountingLoop *ClosedForms::findLoop(int header) const {
+    auto it = loops.find(header);
+    return it == loops.end() ? nullptr : &it->second;
+}
+
+int ClosedForms::size() const {
+    return loops.size();
+}
+
+ClosedLoop::ClosedLoop(const CountingLoop &loop, EvalState &state) : loop(loop) {
+    inductionSlot = state.getSlot(loop.induction);
+    reads.push_back(inductionSlot);
+    if (loop.limit->getType() == IDENTIFIER) {
+        limitSlot = state.getSlot(loop.limit->toString());
+        reads.push_back(limitSlot);
+    } else {
+        limitValue = ((ConstantExp *) loop.limit)->getValue();
+    }
+    for (const ClosedUpdate &update : loop.updates) {
+        int slot = state.getSlot(update.var);
+        updateSlots.push_back(slot);
+        if (update.self != nullptr) {
+            reads.push_back(slot);
+            zeros.insert(update.self);
+        }
+        std::vector<Expression *> pending = {update.exp};
+        while (!pending.empty()) {
+            Expression *exp = pending.back();
+            pending.pop_back();
+            if (exp->getType() == COMPOUND) {
+                pending.push_back(((CompoundExp *) exp)->getLHS());
+                pending.push_back(((CompoundExp *) exp)->getRHS());
+            } else if (exp->getType() == IDENTIFIER && exp != update.self
+                       && exp->toString() != loop.induction) {
+                slots[exp] = state.getSlot(exp->toString());
+                reads.push_back(slots[exp]);
+            }
+        }
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The body runs once before the first test, and every test sees the
+ * stepped induction variable, so the loop runs count times where count
+ * is the smallest positive number of steps that reaches the limit.
+ * Before that the induction variable moves towards the limit without
+ * wrapping; only the final value needs checking.
+ *
+ * All other arithmetic is done modulo 2^32, which is exactly what the
+ * wrapping int arithmetic of the interpreter computes.  An update of
+ * degree d, seen at iteration k, is a polynomial g(k) of degree d, so
+ * by Newton's forward difference formula
+ *
+ *     g(0) + ... + g(count - 1) = sum over j of D^j g(0) * C(count, j + 1)
+ *
+ * where D^j g(0) comes from the values g(0), ..., g(d).
+ */
+
+bool ClosedLoop::run(int *values, char *defined) const {
+    for (int slot : reads) {
+        if (!defined[slot]) return false;
+    }
+    long long start = values[inductionSlot];
+    long long limit = limitSlot == -1 ? limitValue : values[limitSlot];
+    long long stride = loop.step > 0 ? loop.step : -(long long) loop.step;
+    long long distance = loop.step > 0 ? limit - start : start - limit;
+    long long count = distance <= stride ? 1 : (distance + stride - 1) / stride;
+    long long end = start + loop.step * count;
+    if (end < INT_MIN || end > INT_MAX) return false;
+
+    unsigned step = loop.step;
+    for (size_t u = 0; u < loop.updates.size(); u++) {
+        const ClosedUpdate &update = loop.updates[u];
+        int slot = updateSlots[u];
+        unsigned first = (unsigned) start + (update.shifted ? step : 0);
+        if (update.self == nullptr) {
+            values[slot] = eval(update.exp, values, first + step * (unsigned) (count - 1));
+            defined[slot] = true;
+            continue;
+        }
+        unsigned differences[ClosedForms::MAX_DEGREE + 1];
+        for (int k = 0; k <= update.degree; k++) {
+            differences[k] = eval(update.exp, values, first + step * k);
+        }
+        for (int j = 1; j <= update.degree; j++) {
+            for (int k = update.degree; k >= j; k--) differences[k] -= differences[k - 1];
+        }
+        unsigned sum = 0;
+        for (int j = 0; j <= update.degree; j++) {
+            sum += differences[j] * binomial(count, j + 1);
+        }
+        values[slot] = (unsigned) values[slot] + sum;
+    }
+    values[inductionSlot] = end;
+    return true;
+}
+
+unsigned ClosedLoop::eval(Expression *exp, const int *values, unsigned induction) const {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return ((ConstantExp *) exp)->getValue();
+        case IDENTIFIER: {
+            if (zeros.count(exp)) return 0;
+            auto it = slots.find(exp);
+            return it == slots.end() ? induction : values[it->second];
+        }
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            unsigned left = eval(compound->getLHS(), values, induction);
+            unsigned right = eval(compound->getRHS(), values, induction);
+            std::string op = compound->getOp();
+            if (op == "+") return left + right;
+            if (op == "-") return left - right;
+            return left * right;
+        }
+    }
+}
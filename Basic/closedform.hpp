@@ -0,0 +1,177 @@
+/*
+ * File: closedform.h
+ * ------------------
+ * This interface exports the ClosedForms class, which finds the
+ * counting loops of an ExecutionPlan whose final state can be computed
+ * directly from their entry state, and the ClosedLoop class, which the
+ * bytecode VM uses to do that computation instead of iterating.
+ */
+
+#ifndef _closedform_h
+#define _closedform_h
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "plan.hpp"
+
+/*
+ * Type: ClosedUpdate
+ * ------------------
+ * One LET var = exp of a counting loop other than its induction step.
+ * A polynomial in the induction variable uses only +, - and *, the
+ * induction variable, constants and variables the loop never assigns.
+ * Either exp is such a polynomial, or self is its only read of var and
+ * exp adds var to such a polynomial, which is exp with self read as 0.
+ * shifted is set when the LET comes after the induction step and so
+ * sees the stepped value.
+ */
+
+struct ClosedUpdate {
+    std::string var;
+    Expression *exp;
+    Expression *self;
+    bool shifted;
+    int degree;
+};
+
+/*
+ * Type: CountingLoop
+ * ------------------
+ * A loop made of the single basic block [header, latch].  The block
+ * consists of LETs and ends with an IF that jumps back to header while
+ * induction < limit (step > 0) or induction > limit (step < 0).  One
+ * of the LETs is the induction step LET induction = induction + step;
+ * the others are listed in updates.  limit is a constant or a variable
+ * the loop never assigns.
+ */
+
+struct CountingLoop {
+    int header;
+    int latch;
+    std::string induction;
+    int step;
+    Expression *limit;
+    std::vector<ClosedUpdate> updates;
+};
+
+/*
+ * Function: stepOf
+ * Usage: if (stepOf(exp, var, step)) . . .
+ * ----------------------------------------
+ * Returns true and sets step if exp is var + c, c + var or var - c
+ * for a nonzero constant c, which makes LET var = exp an induction
+ * step.
+ */
+
+bool stepOf(Expression *exp, const std::string &var, int &step);
+
+/*
+ * Class: ClosedForms
+ * ------------------
+ * Finds the counting loops of a plan.  Polynomials are limited to
+ * MAX_DEGREE in the induction variable, which bounds the work of
+ * summing one in closed form.
+ */
+
+class ClosedForms {
+
+public:
+
+/*
+ * Constructor: ClosedForms
+ * Usage: ClosedForms closedForms(plan);
+ * -------------------------------------
+ * Analyzes the loops of plan.  The results refer to the statements
+ * of the plan and are valid as long as the plan is.
+ */
+
+    explicit ClosedForms(const ExecutionPlan &plan);
+
+/*
+ * Method: findLoop
+ * Usage: const CountingLoop *loop = closedForms.findLoop(step);
+ * -------------------------------------------------------------
+ * Returns the counting loop whose header is the given step, or
+ * nullptr if there is none.
+ */
+
+    const CountingLoop *findLoop(int header) const;
+
+/*
+ * Method: size
+ * Usage: int count = closedForms.size();
+ * --------------------------------------
+ * Returns the number of counting loops found.
+ */
+
+    int size() const;
+
+/*
+ * Constant: MAX_DEGREE
+ * --------------------
+ * The highest degree of a polynomial a counting loop may sum.
+ */
+
+    static const int MAX_DEGREE = 4;
+
+private:
+
+    void analyze(const ExecutionPlan &plan, int block);
+
+    std::unordered_map<int, CountingLoop> loops;
+
+};
+
+/*
+ * Class: ClosedLoop
+ * -----------------
+ * A CountingLoop with its variables bound to EvalState slots, ready to
+ * run against the slot arrays of that state.
+ */
+
+class ClosedLoop {
+
+public:
+
+/*
+ * Constructor: ClosedLoop
+ * Usage: ClosedLoop closed(loop, state);
+ * --------------------------------------
+ * Binds the variables of loop to the slots of state.
+ */
+
+    ClosedLoop(const CountingLoop &loop, EvalState &state);
+
+/*
+ * Method: run
+ * Usage: if (closed.run(values, defined)) . . .
+ * ---------------------------------------------
+ * Sets the variables to the values they would have when the loop,
+ * entered at its header in the given state, leaves through its IF,
+ * and returns true.  Returns false without changing anything if it
+ * cannot: when a variable the loop reads is not defined, or when the
+ * induction variable would wrap around before the loop ends.
+ */
+
+    bool run(int *values, char *defined) const;
+
+private:
+
+    unsigned eval(Expression *exp, const int *values, unsigned induction) const;
+
+    const CountingLoop &loop;
+    int inductionSlot;
+    int limitSlot = -1;
+    int limitValue = 0;
+    std::vector<int> updateSlots;
+    std::vector<int> reads;
+    std::unordered_map<Expression *, int> slots;
+    std::unordered_set<Expression *> zeros;
+
+};
+
+#endif
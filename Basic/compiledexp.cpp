@@ -0,0 +1,325 @@
+/*
+ * File: compiledexp.cpp
+ * ---------------------
+ * This file implements the CompiledExp class.
+ */
+
+#include "compiledexp.hpp"
+#include "options.hpp"
+#include "Utils/error.hpp"
+#include "Utils/strlib.hpp"
+#include <set>
+
+/*
+ * Implementation notes: operators and right operands
+ * --------------------------------------------------
+ * Each operator type knows how to combine two values, and each right
+ * operand type knows where the second value comes from.  applyOp
+ * combines one of each, so every arithmetic opcode is one
+ * instantiation with its operand fetch inlined.  The left operand is
+ * always on the stack and so has been evaluated first, which keeps the
+ * order of VARIABLE NOT DEFINED and DIVIDE BY ZERO errors the same as
+ * in CompoundExp::eval.
+ */
+
+namespace {
+
+struct AddOp {
+    static int apply(int left, int right) {
+        return left + right;
+    }
+};
+
+struct SubOp {
+    static int apply(int left, int right) {
+        return left - right;
+    }
+};
+
+struct MulOp {
+    static int apply(int left, int right) {
+        return left * right;
+    }
+};
+
+struct DivOp {
+    static int apply(int left, int right) {
+        if (right == 0) error("DIVIDE BY ZERO");
+        return left / right;
+    }
+};
+
+struct StackOperand {
+    static int get(int *&sp, int, EvalState &) {
+        return *--sp;
+    }
+};
+
+struct ConstOperand {
+    static int get(int *&, int operand, EvalState &) {
+        return operand;
+    }
+};
+
+struct VarOperand {
+    static int get(int *&, int operand, EvalState &state) {
+        if (!state.isSlotDefined(operand)) error("VARIABLE NOT DEFINED");
+        return state.getSlotValue(operand);
+    }
+};
+
+template <typename Operator, typename Right>
+inline void applyOp(int *&sp, int operand, EvalState &state) {
+    int right = Right::get(sp, operand, state);
+    sp[-1] = Operator::apply(sp[-1], right);
+}
+
+const char OPERATORS[] = "+-*/";
+
+/*
+ * Function: measure
+ * Usage: if (measure(exp, cost, names)) . . .
+ * -------------------------------------------
+ * Adds the number of instructions compile emits for exp to cost and
+ * the variables it reads to names.  Returns false if exp assigns.
+ */
+
+bool measure(Expression *exp, int &cost, std::set<std::string> &names) {
+    cost++;
+    if (exp->getType() == CONSTANT) return true;
+    if (exp->getType() == IDENTIFIER) {
+        names.insert(((IdentifierExp *) exp)->getName());
+        return true;
+    }
+    CompoundExp *compound = (CompoundExp *) exp;
+    if (compound->getOp() == "=" || !measure(compound->getLHS(), cost, names)) return false;
+    Expression *rhs = compound->getRHS();
+    if (rhs->getType() == COMPOUND) return measure(rhs, cost, names);
+    if (rhs->getType() == IDENTIFIER) names.insert(((IdentifierExp *) rhs)->getName());
+    return true;
+}
+
+}
+
+CompiledExp::CompiledExp(Expression *exp, EvalState &state) {
+    compile(exp, state);
+}
+
+int CompiledExp::eval(EvalState &state) const {
+    if (maxDepth <= STACK_SIZE) {
+        int stack[STACK_SIZE];
+        return run(state, stack);
+    }
+    std::vector<int> stack(maxDepth);
+    return run(state, stack.data());
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * ARITHMETIC_CASES expands the three forms of one operator into switch
+ * cases.  BAD_ASSIGN is never reached, since RAISE_SYNTAX_ERROR comes
+ * before it.  A memo that is still valid pushes its value and skips
+ * to its MEMO_END, which leaves the stack as evaluating it would.
+ */
+
+#define ARITHMETIC_CASES(NAME, OPERATOR)                                      \
+    case NAME:                                                                \
+        applyOp<OPERATOR, StackOperand>(sp, ins.operand, state);              \
+        break;                                                                \
+    case NAME##_CONST:                                                        \
+        applyOp<OPERATOR, ConstOperand>(sp, ins.operand, state);              \
+        break;                                                                \
+    case NAME##_VAR:                                                          \
+        applyOp<OPERATOR, VarOperand>(sp, ins.operand, state);                \
+        break;
+
+int CompiledExp::run(EvalState &state, int *stack) const {
+    int *sp = stack;
+    const Instruction *base = code.data();
+    const Instruction *end = base + code.size();
+    for (const Instruction *pc = base; pc != end; pc++) {
+        const Instruction &ins = *pc;
+        switch (ins.op) {
+            case PUSH_CONST:
+                *sp++ = ins.operand;
+                break;
+            case PUSH_VAR: {
+                int value = VarOperand::get(sp, ins.operand, state);
+                *sp++ = value;
+                break;
+            }
+            case ASSIGN:
+                state.setSlotValue(ins.operand, sp[-1]);
+                break;
+            case RAISE_SYNTAX_ERROR:
+            case BAD_ASSIGN:
+                error("SYNTAX ERROR");
+                break;
+            case MEMO_BEGIN: {
+                Memo &memo = memos[ins.operand];
+                if (lookup(memo, state)) {
+                    *sp++ = memo.value;
+                    pc = base + memo.end;
+                }
+                break;
+            }
+            case MEMO_END:
+                save(memos[ins.operand], state, sp[-1]);
+                break;
+            ARITHMETIC_CASES(ADD, AddOp)
+            ARITHMETIC_CASES(SUB, SubOp)
+            ARITHMETIC_CASES(MUL, MulOp)
+            ARITHMETIC_CASES(DIV, DivOp)
+        }
+    }
+    return sp[-1];
+}
+
+#undef ARITHMETIC_CASES
+
+/*
+ * Implementation notes: lookup, save
+ * ----------------------------------
+ * The first MEMO_TRIAL checks of a memo are counted, and a memo that
+ * hit too few of them is switched off for good: it stops checking and
+ * stops saving, and its subexpression is simply evaluated.
+ */
+
+bool CompiledExp::lookup(Memo &memo, EvalState &state) const {
+    if (!memo.enabled) return false;
+    bool hit = memo.valid && memo.epoch == state.getEpoch();
+    for (size_t i = 0; hit && i < memo.slots.size(); i++) {
+        hit = memo.versions[i] == state.getSlotVersion(memo.slots[i]);
+    }
+    if (memo.checks < MEMO_TRIAL) {
+        memo.checks++;
+        if (hit) memo.hits++;
+        if (memo.checks == MEMO_TRIAL && memo.hits * MEMO_MIN_HIT_RATE < MEMO_TRIAL) {
+            memo.enabled = false;
+        }
+    }
+    return hit;
+}
+
+void CompiledExp::save(Memo &memo, EvalState &state, int value) const {
+    if (!memo.enabled) return;
+    memo.value = value;
+    memo.epoch = state.getEpoch();
+    for (size_t i = 0; i < memo.slots.size(); i++) {
+        memo.versions[i] = state.getSlotVersion(memo.slots[i]);
+    }
+    memo.valid = true;
+}
+
+/*
+ * Implementation notes: toString
+ * ------------------------------
+ * The postfix code is run over a stack of strings instead of values.
+ */
+
+std::string CompiledExp::toString(const EvalState &state) const {
+    std::vector<std::string> stack;
+    for (const Instruction &ins : code) {
+        if (ins.op == PUSH_CONST) {
+            stack.push_back(integerToString(ins.operand));
+        } else if (ins.op == PUSH_VAR) {
+            stack.push_back(state.getSlotName(ins.operand));
+        } else if (ins.op == ASSIGN) {
+            stack.back() = '(' + state.getSlotName(ins.operand) + " = " + stack.back() + ')';
+        } else if (ins.op == BAD_ASSIGN) {
+            std::string rhs = stack.back();
+            stack.pop_back();
+            stack.back() = '(' + stack.back() + " = " + rhs + ')';
+        } else if (ins.op >= ADD) {
+            int form = (ins.op - ADD) / 4;
+            char op = OPERATORS[(ins.op - ADD) % 4];
+            std::string rhs;
+            if (form == 0) {
+                rhs = stack.back();
+                stack.pop_back();
+            } else if (form == 1) {
+                rhs = integerToString(ins.operand);
+            } else {
+                rhs = state.getSlotName(ins.operand);
+            }
+            stack.back() = '(' + stack.back() + ' ' + op + ' ' + rhs + ')';
+        }
+    }
+    return stack.back();
+}
+
+/*
+ * Implementation notes: compile
+ * -----------------------------
+ * A constant or variable right operand is folded into the arithmetic
+ * instruction.  The checks CompoundExp::eval makes on every evaluation
+ * of "=" are made here once.  The code of a malformed assignment is
+ * kept after RAISE_SYNTAX_ERROR only so that toString can show it.
+ * Memos are only placed around the largest subexpressions that
+ * qualify, never inside one another.
+ */
+
+void CompiledExp::compile(Expression *exp, EvalState &state) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            emit(PUSH_CONST, ((ConstantExp *) exp)->getValue(), 1);
+            break;
+        case IDENTIFIER:
+            emit(PUSH_VAR, state.getSlot(((IdentifierExp *) exp)->getName()), 1);
+            break;
+        case COMPOUND: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            Expression *lhs = compound->getLHS();
+            Expression *rhs = compound->getRHS();
+            if (op == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") {
+                    emit(RAISE_SYNTAX_ERROR, 0, 0);
+                    compile(lhs, state);
+                    compile(rhs, state);
+                    emit(BAD_ASSIGN, 0, -1);
+                } else {
+                    compile(rhs, state);
+                    emit(ASSIGN, state.getSlot(((IdentifierExp *) lhs)->getName()), 0);
+                }
+                break;
+            }
+            int cost = 0;
+            std::set<std::string> names;
+            if (options.memoization && !memoizing && measure(exp, cost, names)
+                && cost >= MEMO_MIN_COST && (int) names.size() <= MEMO_MAX_SLOTS) {
+                int index = memos.size();
+                memos.emplace_back();
+                for (const std::string &name : names) {
+                    memos[index].slots.push_back(state.getSlot(name));
+                }
+                memos[index].versions.resize(names.size());
+                emit(MEMO_BEGIN, index, 0);
+                memoizing = true;
+                compile(exp, state);
+                memoizing = false;
+                memos[index].end = code.size();
+                emit(MEMO_END, index, 0);
+                break;
+            }
+            int index = op == "+" ? 0 : op == "-" ? 1 : op == "*" ? 2 : 3;
+            compile(lhs, state);
+            if (rhs->getType() == CONSTANT) {
+                emit(Op(ADD_CONST + index), ((ConstantExp *) rhs)->getValue(), 0);
+            } else if (rhs->getType() == IDENTIFIER) {
+                emit(Op(ADD_VAR + index), state.getSlot(((IdentifierExp *) rhs)->getName()), 0);
+            } else {
+                compile(rhs, state);
+                emit(Op(ADD + index), 0, -1);
+            }
+            break;
+        }
+    }
+}
+
+void CompiledExp::emit(Op op, int operand, int effect) {
+    code.push_back({op, operand});
+    depth += effect;
+    if (depth > maxDepth) maxDepth = depth;
+}
@@ -0,0 +1,157 @@
+/*
+ * File: compiledexp.h
+ * -------------------
+ * This interface exports the CompiledExp class, a form of an
+ * Expression tree that is prepared once and then evaluated without
+ * virtual calls, operator string compares or variable name lookups.
+ * The statement classes use it in place of Expression::eval.
+ */
+
+#ifndef _compiledexp_h
+#define _compiledexp_h
+
+#include <string>
+#include <vector>
+#include "evalstate.hpp"
+#include "exp.hpp"
+
+/*
+ * Class: CompiledExp
+ * ------------------
+ * A compiled expression is one contiguous array of postfix
+ * instructions, each an opcode and a 32-bit operand, evaluated on a
+ * small fixed-size operand stack.  Every arithmetic instruction is
+ * specialized on the shape of its right operand: a value on the stack,
+ * a constant or a variable carried in the operand.  So X + 1 runs as
+ * PUSH_VAR X, ADD_CONST 1 and I * J as PUSH_VAR I, MUL_VAR J, with the
+ * code for each form generated from one template.
+ *
+ * A subexpression that assigns nothing, costs at least MEMO_MIN_COST
+ * instructions and reads at most MEMO_MAX_SLOTS variables is memoized:
+ * its value is kept together with the versions of the slots it read,
+ * and as long as none of them has been stored to since, the value is
+ * used without evaluating the subexpression again.  Each memo measures
+ * its own hit rate over its first MEMO_TRIAL checks and switches
+ * itself off if it stays below one in MEMO_MIN_HIT_RATE, because then
+ * the checks cost more than they save.
+ */
+
+class CompiledExp {
+
+public:
+
+/*
+ * Constructor: CompiledExp
+ * Usage: CompiledExp *compiled = new CompiledExp(exp, state);
+ * -----------------------------------------------------------
+ * Compiles exp into postfix order, binding every variable to its slot
+ * in state.  The expression tree is only read; it is not kept.
+ */
+
+    CompiledExp(Expression *exp, EvalState &state);
+
+/*
+ * Method: eval
+ * Usage: int value = compiled->eval(state);
+ * -----------------------------------------
+ * Evaluates the expression exactly as Expression::eval would,
+ * including the errors it raises.  state must be the EvalState the
+ * expression was compiled against.
+ */
+
+    int eval(EvalState &state) const;
+
+/*
+ * Method: toString
+ * Usage: string str = compiled->toString(state);
+ * ----------------------------------------------
+ * Reconstructs the infix form of the expression from the postfix
+ * code, in the fully parenthesized format of Expression::toString.
+ * Variable names are looked up in the slot table of state.
+ */
+
+    std::string toString(const EvalState &state) const;
+
+/*
+ * Constant: STACK_SIZE
+ * --------------------
+ * The depth of the operand stack eval keeps in its own frame.  Deeper
+ * expressions, which need very unusual nesting, use a heap stack.
+ */
+
+    static const int STACK_SIZE = 32;
+
+/*
+ * Constants: MEMO_MIN_COST, MEMO_MAX_SLOTS, MEMO_TRIAL, MEMO_MIN_HIT_RATE
+ * -----------------------------------------------------------------------
+ * The limits that decide which subexpressions are memoized and which
+ * memos stay on.
+ */
+
+    static const int MEMO_MIN_COST = 5;
+    static const int MEMO_MAX_SLOTS = 4;
+    static const int MEMO_TRIAL = 64;
+    static const int MEMO_MIN_HIT_RATE = 4;
+
+private:
+
+/*
+ * Type: Op
+ * --------
+ * The postfix instruction set.  The arithmetic opcodes come in three
+ * groups of four, in the order +, -, *, /, for a right operand on the
+ * stack, in the operand as a constant, and in the operand as a slot.
+ * A malformed assignment compiles into RAISE_SYNTAX_ERROR followed by
+ * the code of both sides and BAD_ASSIGN; eval stops at the first of
+ * these, and toString only needs the second.  The code of a memoized
+ * subexpression is enclosed in MEMO_BEGIN and MEMO_END, whose operand
+ * is the index of the memo.
+ */
+
+    enum Op {
+        PUSH_CONST, PUSH_VAR, ASSIGN, RAISE_SYNTAX_ERROR, BAD_ASSIGN,
+        MEMO_BEGIN, MEMO_END,
+        ADD, SUB, MUL, DIV,
+        ADD_CONST, SUB_CONST, MUL_CONST, DIV_CONST,
+        ADD_VAR, SUB_VAR, MUL_VAR, DIV_VAR
+    };
+
+    struct Instruction {
+        Op op;
+        int operand;
+    };
+
+/*
+ * Type: Memo
+ * ----------
+ * The value of a memoized subexpression, the slots it reads and their
+ * versions when it was computed.  end is the index of its MEMO_END.
+ */
+
+    struct Memo {
+        int end;
+        std::vector<int> slots;
+        std::vector<unsigned> versions;
+        unsigned epoch = 0;
+        bool valid = false;
+        bool enabled = true;
+        int value = 0;
+        int checks = 0;
+        int hits = 0;
+    };
+
+    int run(EvalState &state, int *stack) const;
+    bool lookup(Memo &memo, EvalState &state) const;
+    void save(Memo &memo, EvalState &state, int value) const;
+    void compile(Expression *exp, EvalState &state);
+    void emit(Op op, int operand, int effect);
+
+    std::vector<Instruction> code;
+    mutable std::vector<Memo> memos;
+    bool memoizing = false;
+    int depth = 0;
+    int maxDepth = 0;
+
+};
+
+#endif
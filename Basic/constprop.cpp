@@ -0,0 +1,308 @@
+/*
+ * File: constprop.cpp
+ * -------------------
+ * This file implements the ConstantPropagation class.
+ */
+
+#include "constprop.hpp"
+#include <climits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+/*
+ * Type: Value
+ * -----------
+ * The abstract value of a variable or expression.  UNREACHED is the
+ * state of a block no path has reached yet; VARYING means the value is
+ * not known to be a single constant.
+ */
+
+enum ValueKind {
+    UNREACHED, KNOWN, VARYING
+};
+
+struct Value {
+    ValueKind kind;
+    int constant;
+};
+
+const Value VARYING_VALUE = {VARYING, 0};
+
+typedef std::vector<Value> Environment;
+
+bool meet(Value &into, const Value &other) {
+    if (other.kind == UNREACHED || into.kind == VARYING) return false;
+    if (into.kind == UNREACHED) {
+        into = other;
+        return true;
+    }
+    if (other.kind == KNOWN && other.constant == into.constant) return false;
+    into = VARYING_VALUE;
+    return true;
+}
+
+/*
+ * Type: Result
+ * ------------
+ * The abstract value of an expression together with whether the
+ * expression could be replaced by that value, which rules out any
+ * node that might fail or assign.
+ */
+
+struct Result {
+    Value value;
+    bool replaceable;
+};
+
+/*
+ * Class: Analyzer
+ * ---------------
+ * Holds the variable numbering and the block entry environments while
+ * the analysis runs.
+ */
+
+class Analyzer {
+
+public:
+
+    Analyzer(const ExecutionPlan &plan, std::unordered_map<Expression *, int> &constants)
+            : plan(plan), constants(constants) {
+    }
+
+    void run();
+
+private:
+
+    int variable(const std::string &name);
+    void collect(Expression *exp);
+    std::vector<int> transfer(int block, Environment &env);
+    Result eval(Expression *exp, Environment &env);
+
+    const ExecutionPlan &plan;
+    std::unordered_map<Expression *, int> &constants;
+    std::map<std::string, int> variables;
+    std::vector<Environment> entries;
+    std::vector<char> reached;
+    bool recording = false;
+
+};
+
+int Analyzer::variable(const std::string &name) {
+    auto it = variables.find(name);
+    if (it != variables.end()) return it->second;
+    int index = variables.size();
+    variables.emplace(name, index);
+    return index;
+}
+
+void Analyzer::collect(Expression *exp) {
+    if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getName());
+    } else if (exp->getType() == COMPOUND) {
+        collect(((CompoundExp *) exp)->getLHS());
+        collect(((CompoundExp *) exp)->getRHS());
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * A standard worklist iteration: each variable can only move from
+ * UNREACHED to KNOWN to VARYING, so it terminates after a few passes
+ * over each block.  A last pass over the reached blocks records the
+ * constant nodes against the final entry environments.
+ */
+
+void Analyzer::run() {
+    int count = plan.getBlockCount();
+    if (count == 0) return;
+    for (int i = 0; i < plan.size(); i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET:
+                variable(((LetStmt *) stmt)->getVar());
+                collect(((LetStmt *) stmt)->getExp());
+                break;
+            case PRINT:
+                collect(((PrintStmt *) stmt)->getExp());
+                break;
+            case INPUT:
+                variable(((InputStmt *) stmt)->getVar());
+                break;
+            case IF:
+                collect(((IfStmt *) stmt)->getLHS());
+                collect(((IfStmt *) stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    Value unreached = {UNREACHED, 0};
+    entries.assign(count, Environment(variables.size(), unreached));
+    entries[0].assign(variables.size(), VARYING_VALUE);
+    reached.assign(count, false);
+    reached[0] = true;
+    std::vector<int> worklist = {0};
+    std::vector<char> queued(count, false);
+    queued[0] = true;
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        queued[block] = false;
+        Environment env = entries[block];
+        for (int successor : transfer(block, env)) {
+            bool changed = !reached[successor];
+            reached[successor] = true;
+            for (size_t v = 0; v < env.size(); v++) {
+                if (meet(entries[successor][v], env[v])) changed = true;
+            }
+            if (changed && !queued[successor]) {
+                queued[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+    recording = true;
+    for (int block = 0; block < count; block++) {
+        if (!reached[block]) continue;
+        Environment env = entries[block];
+        transfer(block, env);
+    }
+}
+
+/*
+ * Implementation notes: transfer
+ * ------------------------------
+ * Runs the statements of a block over env and returns the blocks that
+ * can follow it.  Expressions are evaluated left to right, just as at
+ * run time, so that assignments inside expressions are seen in order.
+ */
+
+std::vector<int> Analyzer::transfer(int block, Environment &env) {
+    const BasicBlock &range = plan.getBlock(block);
+    for (int i = range.first; i <= range.last; i++) {
+        const PlanStep &step = plan.getStep(i);
+        Statement *stmt = step.stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET: {
+                LetStmt *let = (LetStmt *) stmt;
+                Value value = eval(let->getExp(), env).value;
+                env[variable(let->getVar())] = value;
+                break;
+            }
+            case PRINT:
+                eval(((PrintStmt *) stmt)->getExp(), env);
+                break;
+            case INPUT:
+                env[variable(((InputStmt *) stmt)->getVar())] = VARYING_VALUE;
+                break;
+            case GOTO:
+                if (step.badTarget || step.target == END_OF_PLAN) return {};
+                return {plan.getBlockOf(step.target)};
+            case IF: {
+                if (step.badTarget) return {};
+                IfStmt *ifStmt = (IfStmt *) stmt;
+                Value lhs = eval(ifStmt->getLHS(), env).value;
+                Value rhs = eval(ifStmt->getRHS(), env).value;
+                int taken = step.target == END_OF_PLAN ? -1 : plan.getBlockOf(step.target);
+                int fallen = step.next == END_OF_PLAN ? -1 : plan.getBlockOf(step.next);
+                std::vector<int> successors;
+                if (lhs.kind == KNOWN && rhs.kind == KNOWN) {
+                    char op = ifStmt->getOp()[0];
+                    bool test = op == '=' ? lhs.constant == rhs.constant
+                                : op == '<' ? lhs.constant < rhs.constant
+                                : lhs.constant > rhs.constant;
+                    if (test) fallen = -1;
+                    else taken = -1;
+                }
+                if (fallen != -1) successors.push_back(fallen);
+                if (taken != -1) successors.push_back(taken);
+                return successors;
+            }
+            case END:
+                return {};
+            default:
+                break;
+        }
+    }
+    const PlanStep &last = plan.getStep(range.last);
+    if (last.next == END_OF_PLAN) return {};
+    return {plan.getBlockOf(last.next)};
+}
+
+/*
+ * Implementation notes: eval
+ * --------------------------
+ * Mirrors CompoundExp::eval.  A division that would fail, or an
+ * assignment to something that is not a variable, gives VARYING: the
+ * program stops there, so nothing after it depends on the result.
+ */
+
+Result Analyzer::eval(Expression *exp, Environment &env) {
+    Result result = {VARYING_VALUE, false};
+    switch (exp->getType()) {
+        case CONSTANT:
+            result.value = {KNOWN, ((ConstantExp *) exp)->getValue()};
+            result.replaceable = true;
+            return result;
+        case IDENTIFIER:
+            result.value = env[variable(((IdentifierExp *) exp)->getName())];
+            result.replaceable = result.value.kind == KNOWN;
+            break;
+        case COMPOUND: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            Expression *lhs = compound->getLHS();
+            if (op == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") return result;
+                result.value = eval(compound->getRHS(), env).value;
+                env[variable(((IdentifierExp *) lhs)->getName())] = result.value;
+                return result;
+            }
+            Result left = eval(lhs, env);
+            Result right = eval(compound->getRHS(), env);
+            if (left.value.kind != KNOWN || right.value.kind != KNOWN) return result;
+            unsigned a = left.value.constant, b = right.value.constant;
+            int value;
+            if (op == "+") {
+                value = (int) (a + b);
+            } else if (op == "-") {
+                value = (int) (a - b);
+            } else if (op == "*") {
+                value = (int) (a * b);
+            } else {
+                if (b == 0 || (left.value.constant == INT_MIN && right.value.constant == -1)) {
+                    return result;
+                }
+                value = left.value.constant / right.value.constant;
+            }
+            result.value = {KNOWN, value};
+            result.replaceable = left.replaceable && right.replaceable;
+            break;
+        }
+    }
+    if (recording && result.replaceable) constants[exp] = result.value.constant;
+    return result;
+}
+
+}
+
+ConstantPropagation::ConstantPropagation(const ExecutionPlan &plan) {
+    Analyzer(plan, constants).run();
+}
+
+bool ConstantPropagation::lookup(Expression *exp, int &value) const {
+    auto it = constants.find(exp);
+    if (it == constants.end()) return false;
+    value = it->second;
+    return true;
+}
+
+int ConstantPropagation::size() const {
+    return constants.size();
+}
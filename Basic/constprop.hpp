@@ -0,0 +1,71 @@
+/*
+ * File: constprop.h
+ * -----------------
+ * This interface exports the ConstantPropagation class, a dataflow
+ * analysis over the basic blocks of an ExecutionPlan that finds the
+ * expressions whose value is the same every time they are evaluated.
+ */
+
+#ifndef _constprop_h
+#define _constprop_h
+
+#include <unordered_map>
+#include "exp.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: ConstantPropagation
+ * --------------------------
+ * The analysis tracks, for every variable at every block entry,
+ * whether it holds one known constant on all paths from the start of
+ * the program.  Since the EvalState survives from one RUN to the next,
+ * every variable is unknown at the start.  IF statements whose
+ * condition folds to a constant only follow the edge they take.
+ *
+ * The result maps expression nodes to their constant value.  A node
+ * is listed only if replacing it with the constant is exact: the node
+ * is reached, always has that value there, reads only variables known
+ * to be assigned, cannot fail, and performs no assignment.  So a
+ * variable listed as constant can never raise VARIABLE NOT DEFINED.
+ */
+
+class ConstantPropagation {
+
+public:
+
+/*
+ * Constructor: ConstantPropagation
+ * Usage: ConstantPropagation constants(plan);
+ * -------------------------------------------
+ * Runs the analysis over plan.  The results refer to the Expression
+ * objects of the plan's statements and stay valid until the program
+ * is edited.
+ */
+
+    explicit ConstantPropagation(const ExecutionPlan &plan);
+
+/*
+ * Method: lookup
+ * Usage: if (constants.lookup(exp, value)) . . .
+ * ----------------------------------------------
+ * Returns true and sets value if exp can be replaced by a constant.
+ */
+
+    bool lookup(Expression *exp, int &value) const;
+
+/*
+ * Method: size
+ * Usage: int count = constants.size();
+ * ------------------------------------
+ * Returns the number of expression nodes that can be replaced.
+ */
+
+    int size() const;
+
+private:
+
+    std::unordered_map<Expression *, int> constants;
+
+};
+
+#endif
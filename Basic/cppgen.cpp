@@ -0,0 +1,265 @@
+/*
+ * File: cppgen.cpp
+ * ----------------
+ * Implements the cppgen.h interface.
+ */
+
+#include "cppgen.hpp"
+#include <map>
+#include <set>
+#include <string>
+
+/*
+ * Implementation notes: the generated program
+ * -------------------------------------------
+ * Runtime errors are thrown as a BasicError and printed by main, which
+ * matches RUN stopping at the first error.  Expressions are flattened
+ * into one temporary per node so the C++ code evaluates operands in the
+ * same left-to-right order as CompoundExp::eval, and arithmetic goes
+ * through unsigned helpers to keep the interpreter's 32-bit wraparound
+ * well defined under optimization.  Each line is wrapped in braces so
+ * a goto never jumps over the initialization of a temporary.
+ */
+
+static const char *PRELUDE =
+        "#include <cctype>\n"
+        "#include <iostream>\n"
+        "#include <string>\n"
+        "\n"
+        "struct BasicError {\n"
+        "    const char *message;\n"
+        "};\n"
+        "\n"
+        "static inline void fail(const char *message) {\n"
+        "    throw BasicError{message};\n"
+        "}\n"
+        "\n"
+        "static inline int add(int a, int b) { return (int) ((unsigned) a + (unsigned) b); }\n"
+        "static inline int sub(int a, int b) { return (int) ((unsigned) a - (unsigned) b); }\n"
+        "static inline int mul(int a, int b) { return (int) ((unsigned) a * (unsigned) b); }\n"
+        "\n"
+        "static inline int divide(int a, int b) {\n"
+        "    if (b == 0) fail(\"DIVIDE BY ZERO\");\n"
+        "    return a / b;\n"
+        "}\n"
+        "\n"
+        "static inline bool isDecimal(const std::string &input) {\n"
+        "    if (input.empty()) return false;\n"
+        "    size_t start = 0;\n"
+        "    if (input[0] == '+' || input[0] == '-') start = 1;\n"
+        "    for (size_t i = start; i < input.length(); ++i) {\n"
+        "        if (!isdigit(input[i])) return false;\n"
+        "    }\n"
+        "    return true;\n"
+        "}\n"
+        "\n"
+        "static inline int input() {\n"
+        "    std::string line;\n"
+        "    while (true) {\n"
+        "        std::cout << \" ? \" << std::flush;\n"
+        "        std::getline(std::cin, line);\n"
+        "        if (isDecimal(line)) return std::stoi(line);\n"
+        "        std::cout << \"INVALID NUMBER\\n\";\n"
+        "    }\n"
+        "}\n"
+        "\n";
+
+class CppGenerator {
+
+public:
+
+    CppGenerator(const ExecutionPlan &plan, std::ostream &out) : plan(plan), out(out) {}
+
+    void generate();
+
+private:
+
+    void generateStep(const PlanStep &step);
+    std::string generateExp(Expression *exp);
+    std::string variable(const std::string &name);
+    std::string temp();
+    std::string label(int step);
+    void collectVariables(Expression *exp);
+
+    const ExecutionPlan &plan;
+    std::ostream &out;
+    std::map<std::string, int> variables;
+    int temps = 0;
+    bool usesEnd = false;
+
+};
+
+void emitCpp(const ExecutionPlan &plan, std::ostream &out) {
+    CppGenerator(plan, out).generate();
+}
+
+void CppGenerator::generate() {
+    std::set<int> targets;
+    for (int i = 0; i < plan.size(); i++) {
+        const PlanStep &step = plan.getStep(i);
+        if (step.target != END_OF_PLAN) targets.insert(step.target);
+        if (step.stmt == nullptr) continue;
+        switch (step.stmt->getType()) {
+            case LET:
+                variable(((LetStmt *) step.stmt)->getVar());
+                collectVariables(((LetStmt *) step.stmt)->getExp());
+                break;
+            case PRINT:
+                collectVariables(((PrintStmt *) step.stmt)->getExp());
+                break;
+            case INPUT:
+                variable(((InputStmt *) step.stmt)->getVar());
+                break;
+            case IF:
+                collectVariables(((IfStmt *) step.stmt)->getLHS());
+                collectVariables(((IfStmt *) step.stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    out << "// Generated from a BASIC program by the COMPILE command.\n";
+    out << PRELUDE;
+    out << "int main() {\n";
+    for (auto &var : variables) {
+        out << "    int v" << var.second << " = 0;\n";
+        out << "    bool d" << var.second << " = false; // " << var.first << "\n";
+    }
+    out << "    try {\n";
+    for (int i = 0; i < plan.size(); i++) {
+        if (targets.count(i)) out << label(i) << ":\n";
+        out << "        {\n";
+        generateStep(plan.getStep(i));
+        out << "        }\n";
+    }
+    out << "    } catch (BasicError &ex) {\n";
+    out << "        std::cout << ex.message << \"\\n\";\n";
+    out << "    }\n";
+    if (usesEnd) out << "end_of_program:\n";
+    out << "    return 0;\n";
+    out << "}\n";
+}
+
+void CppGenerator::generateStep(const PlanStep &step) {
+    Statement *stmt = step.stmt;
+    if (stmt == nullptr) return;
+    std::string indent = "            ";
+    out << indent << "// " << step.lineNumber << "\n";
+    switch (stmt->getType()) {
+        case REM:
+            break;
+        case LET: {
+            LetStmt *let = (LetStmt *) stmt;
+            std::string value = generateExp(let->getExp());
+            std::string var = variable(let->getVar());
+            out << indent << "v" << var << " = " << value << "; d" << var << " = true;\n";
+            break;
+        }
+        case PRINT: {
+            std::string value = generateExp(((PrintStmt *) stmt)->getExp());
+            out << indent << "std::cout << " << value << " << \"\\n\";\n";
+            break;
+        }
+        case INPUT: {
+            std::string var = variable(((InputStmt *) stmt)->getVar());
+            out << indent << "v" << var << " = input(); d" << var << " = true;\n";
+            break;
+        }
+        case GOTO:
+            if (step.badTarget) {
+                out << indent << "fail(\"LINE NUMBER ERROR\");\n";
+            } else {
+                out << indent << "goto " << label(step.target) << ";\n";
+            }
+            break;
+        case IF: {
+            if (step.badTarget) {
+                out << indent << "fail(\"LINE NUMBER ERROR\");\n";
+                break;
+            }
+            IfStmt *ifStmt = (IfStmt *) stmt;
+            std::string lhs = generateExp(ifStmt->getLHS());
+            std::string rhs = generateExp(ifStmt->getRHS());
+            std::string op = ifStmt->getOp() == "=" ? "==" : ifStmt->getOp();
+            out << indent << "if (" << lhs << " " << op << " " << rhs << ") goto "
+                << label(step.target) << ";\n";
+            break;
+        }
+        case END:
+            out << indent << "goto " << label(END_OF_PLAN) << ";\n";
+            break;
+    }
+}
+
+/*
+ * Implementation notes: generateExp
+ * ---------------------------------
+ * Returns a C++ expression for the value of exp after writing the
+ * statements that compute it.  Constants are returned directly; every
+ * other node is materialized in a fresh temporary.
+ */
+
+std::string CppGenerator::generateExp(Expression *exp) {
+    std::string indent = "            ";
+    switch (exp->getType()) {
+        case CONSTANT:
+            return "(" + std::to_string(((ConstantExp *) exp)->getValue()) + ")";
+        case IDENTIFIER: {
+            std::string var = variable(((IdentifierExp *) exp)->getName());
+            std::string t = temp();
+            out << indent << "if (!d" << var << ") fail(\"VARIABLE NOT DEFINED\");\n";
+            out << indent << "int " << t << " = v" << var << ";\n";
+            return t;
+        }
+        case COMPOUND:
+            break;
+    }
+    CompoundExp *compound = (CompoundExp *) exp;
+    std::string op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == "=") {
+        if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") {
+            out << indent << "fail(\"SYNTAX ERROR\");\n";
+            return "0";
+        }
+        std::string value = generateExp(compound->getRHS());
+        std::string var = variable(((IdentifierExp *) lhs)->getName());
+        out << indent << "v" << var << " = " << value << "; d" << var << " = true;\n";
+        return value;
+    }
+    std::string left = generateExp(lhs);
+    std::string right = generateExp(compound->getRHS());
+    std::string fn = op == "+" ? "add" : op == "-" ? "sub" : op == "*" ? "mul" : "divide";
+    std::string t = temp();
+    out << indent << "int " << t << " = " << fn << "(" << left << ", " << right << ");\n";
+    return t;
+}
+
+std::string CppGenerator::variable(const std::string &name) {
+    auto it = variables.find(name);
+    if (it == variables.end()) {
+        it = variables.emplace(name, (int) variables.size()).first;
+    }
+    return std::to_string(it->second);
+}
+
+std::string CppGenerator::temp() {
+    return "t" + std::to_string(temps++);
+}
+
+std::string CppGenerator::label(int step) {
+    if (step == END_OF_PLAN) {
+        usesEnd = true;
+        return "end_of_program";
+    }
+    return "line_" + std::to_string(plan.getStep(step).lineNumber);
+}
+
+void CppGenerator::collectVariables(Expression *exp) {
+    if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getName());
+    } else if (exp->getType() == COMPOUND) {
+        collectVariables(((CompoundExp *) exp)->getLHS());
+        collectVariables(((CompoundExp *) exp)->getRHS());
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * File: cppgen.h
+ * --------------
+ * This file acts as the interface to the C++ code generator, which
+ * translates a linked BASIC program into a self-contained C++ program
+ * for the COMPILE command.
+ */
+
+#ifndef _cppgen_h
+#define _cppgen_h
+
+#include <iostream>
+#include "plan.hpp"
+
+/*
+ * Function: emitCpp
+ * Usage: emitCpp(plan, std::cout);
+ * --------------------------------
+ * Writes one C++ translation unit equivalent to running the plan from
+ * an empty EvalState.  Each line becomes a label, GOTO and IF become
+ * goto, and each variable becomes a local together with a flag that
+ * tracks whether it has been assigned.  The generated program prints
+ * the same output and error messages as RUN, and builds with a plain
+ * g++ invocation.
+ */
+
+void emitCpp(const ExecutionPlan &plan, std::ostream &out);
+
+#endif
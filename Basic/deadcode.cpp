@@ -0,0 +1,322 @@
+/*
+ * File: deadcode.cpp
+ * ------------------
+ * This file implements the DeadCode class.
+ */
+
+#include "deadcode.hpp"
+#include "cfg.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+/*
+ * Type: VariableSet
+ * -----------------
+ * A set of variables, one bit per variable number.
+ */
+
+typedef std::vector<unsigned long long> VariableSet;
+
+/*
+ * Class: Liveness
+ * ---------------
+ * Holds the variable numbering and the live sets at block entries
+ * while the analysis runs.  A variable is live at a point if its
+ * current value may still be read, or may be left behind when the
+ * program stops.
+ */
+
+class Liveness {
+
+public:
+
+    Liveness(const ExecutionPlan &plan, const ConstantPropagation &constants,
+             const DefiniteAssignment &definite, std::unordered_set<Statement *> &dead)
+            : plan(plan), constants(constants), definite(definite), dead(dead) {
+    }
+
+    void run();
+
+private:
+
+    int variable(const std::string &name);
+    void collect(Expression *exp);
+    bool mayFail(Expression *exp) const;
+    bool assigns(Expression *exp) const;
+    void addUses(Expression *exp, VariableSet &live);
+    bool isDeadStore(Statement *stmt, const VariableSet &live);
+    bool canStop(int block) const;
+    VariableSet liveOut(int block) const;
+    void transfer(const PlanStep &step, VariableSet &live);
+
+    const ExecutionPlan &plan;
+    const ConstantPropagation &constants;
+    const DefiniteAssignment &definite;
+    std::unordered_set<Statement *> &dead;
+    std::map<std::string, int> variables;
+    std::vector<VariableSet> entries;
+    VariableSet all;
+
+};
+
+int Liveness::variable(const std::string &name) {
+    auto it = variables.find(name);
+    if (it != variables.end()) return it->second;
+    int index = variables.size();
+    variables.emplace(name, index);
+    return index;
+}
+
+void Liveness::collect(Expression *exp) {
+    if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getName());
+    } else if (exp->getType() == COMPOUND) {
+        collect(((CompoundExp *) exp)->getLHS());
+        collect(((CompoundExp *) exp)->getRHS());
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * Blocks the ControlFlowGraph of the plan finds unreachable are dead
+ * as a whole.  Liveness is then solved
+ * backwards over the reached blocks with a worklist, starting from
+ * empty sets.  A dead LET adds no uses, so a store that only feeds
+ * other dead stores is found dead as well.  A last pass walks each
+ * block from its exit with the final sets and records the dead LETs.
+ */
+
+void Liveness::run() {
+    int count = plan.getBlockCount();
+    if (count == 0) return;
+    for (int i = 0; i < plan.size(); i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET:
+                variable(((LetStmt *) stmt)->getVar());
+                collect(((LetStmt *) stmt)->getExp());
+                break;
+            case PRINT:
+                collect(((PrintStmt *) stmt)->getExp());
+                break;
+            case INPUT:
+                variable(((InputStmt *) stmt)->getVar());
+                break;
+            case IF:
+                collect(((IfStmt *) stmt)->getLHS());
+                collect(((IfStmt *) stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    int words = (variables.size() + 63) / 64;
+    all.assign(words, ~0ULL);
+    entries.assign(count, VariableSet(words, 0));
+
+    const ControlFlowGraph &cfg = plan.getControlFlowGraph();
+    std::vector<int> worklist;
+    for (int block = 0; block < count; block++) {
+        if (cfg.isReachable(block)) {
+            worklist.push_back(block);
+            continue;
+        }
+        const BasicBlock &range = plan.getBlock(block);
+        for (int i = range.first; i <= range.last; i++) {
+            if (plan.getStep(i).stmt != nullptr) dead.insert(plan.getStep(i).stmt);
+        }
+    }
+
+    std::vector<char> queued(count, true);
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        queued[block] = false;
+        VariableSet live = liveOut(block);
+        const BasicBlock &range = plan.getBlock(block);
+        for (int i = range.last; i >= range.first; i--) transfer(plan.getStep(i), live);
+        if (live == entries[block]) continue;
+        entries[block] = live;
+        for (int i = 0; i < cfg.getPredecessorCount(block); i++) {
+            int pred = cfg.getPredecessor(block, i);
+            if (!queued[pred]) {
+                queued[pred] = true;
+                worklist.push_back(pred);
+            }
+        }
+    }
+
+    for (int block = 0; block < count; block++) {
+        if (!cfg.isReachable(block)) continue;
+        VariableSet live = liveOut(block);
+        const BasicBlock &range = plan.getBlock(block);
+        for (int i = range.last; i >= range.first; i--) {
+            const PlanStep &step = plan.getStep(i);
+            if (step.stmt != nullptr && isDeadStore(step.stmt, live)) dead.insert(step.stmt);
+            transfer(step, live);
+        }
+    }
+}
+
+/*
+ * Implementation notes: mayFail
+ * -----------------------------
+ * Follows CompoundExp::eval: a read fails if the variable is not set,
+ * a division fails on 0 and crashes on INT_MIN / -1, and a malformed
+ * assignment raises SYNTAX ERROR.  A node that constant propagation
+ * replaced by its value cannot fail, nor can a read of a variable that
+ * is definitely assigned.
+ */
+
+bool Liveness::mayFail(Expression *exp) const {
+    int value;
+    if (constants.lookup(exp, value)) return false;
+    switch (exp->getType()) {
+        case CONSTANT:
+            return false;
+        case IDENTIFIER:
+            return !definite.isDefined(exp);
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            Expression *lhs = compound->getLHS(), *rhs = compound->getRHS();
+            if (op == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") return true;
+                return mayFail(rhs);
+            }
+            if (op == "/") {
+                if (rhs->getType() != CONSTANT) return true;
+                int divisor = ((ConstantExp *) rhs)->getValue();
+                if (divisor == 0 || divisor == -1) return true;
+            }
+            return mayFail(lhs) || mayFail(rhs);
+        }
+    }
+}
+
+bool Liveness::assigns(Expression *exp) const {
+    if (exp->getType() != COMPOUND) return false;
+    CompoundExp *compound = (CompoundExp *) exp;
+    return compound->getOp() == "=" || assigns(compound->getLHS()) || assigns(compound->getRHS());
+}
+
+/*
+ * Implementation notes: addUses
+ * -----------------------------
+ * The target of a nested assignment is not a use.  Nested assignments
+ * are also not taken to kill anything, which can only make more
+ * variables live.
+ */
+
+void Liveness::addUses(Expression *exp, VariableSet &live) {
+    if (exp->getType() == IDENTIFIER) {
+        int index = variable(((IdentifierExp *) exp)->getName());
+        live[index / 64] |= 1ULL << (index % 64);
+    } else if (exp->getType() == COMPOUND) {
+        CompoundExp *compound = (CompoundExp *) exp;
+        if (compound->getOp() != "=") addUses(compound->getLHS(), live);
+        addUses(compound->getRHS(), live);
+    }
+}
+
+bool Liveness::isDeadStore(Statement *stmt, const VariableSet &live) {
+    if (stmt->getType() != LET) return false;
+    LetStmt *let = (LetStmt *) stmt;
+    int index = variable(let->getVar());
+    if (live[index / 64] & (1ULL << (index % 64))) return false;
+    return !mayFail(let->getExp()) && !assigns(let->getExp());
+}
+
+bool Liveness::canStop(int block) const {
+    const PlanStep &last = plan.getStep(plan.getBlock(block).last);
+    StatementType type = last.stmt == nullptr ? REM : last.stmt->getType();
+    if (type == END || last.badTarget) return true;
+    if ((type == GOTO || type == IF) && last.target == END_OF_PLAN) return true;
+    return type != GOTO && last.next == END_OF_PLAN;
+}
+
+VariableSet Liveness::liveOut(int block) const {
+    if (canStop(block)) return all;
+    VariableSet live(all.size(), 0);
+    for (int successor : plan.getBlock(block).successors) {
+        const VariableSet &entry = entries[successor];
+        for (size_t w = 0; w < live.size(); w++) live[w] |= entry[w];
+    }
+    return live;
+}
+
+/*
+ * Implementation notes: transfer
+ * ------------------------------
+ * Moves live from just after the step to just before it.  A step that
+ * may fail can stop the program with every variable visible, so
+ * everything is live before it.
+ */
+
+void Liveness::transfer(const PlanStep &step, VariableSet &live) {
+    Statement *stmt = step.stmt;
+    if (stmt == nullptr) return;
+    switch (stmt->getType()) {
+        case LET: {
+            if (isDeadStore(stmt, live)) return;
+            LetStmt *let = (LetStmt *) stmt;
+            if (mayFail(let->getExp())) {
+                live = all;
+                return;
+            }
+            int index = variable(let->getVar());
+            live[index / 64] &= ~(1ULL << (index % 64));
+            addUses(let->getExp(), live);
+            break;
+        }
+        case PRINT: {
+            Expression *exp = ((PrintStmt *) stmt)->getExp();
+            if (mayFail(exp)) {
+                live = all;
+            } else {
+                addUses(exp, live);
+            }
+            break;
+        }
+        case INPUT: {
+            int index = variable(((InputStmt *) stmt)->getVar());
+            live[index / 64] &= ~(1ULL << (index % 64));
+            break;
+        }
+        case GOTO:
+            if (step.badTarget) live = all;
+            break;
+        case IF: {
+            IfStmt *ifStmt = (IfStmt *) stmt;
+            if (step.badTarget || mayFail(ifStmt->getLHS()) || mayFail(ifStmt->getRHS())) {
+                live = all;
+            } else {
+                addUses(ifStmt->getLHS(), live);
+                addUses(ifStmt->getRHS(), live);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}
+
+DeadCode::DeadCode(const ExecutionPlan &plan, const ConstantPropagation &constants,
+                   const DefiniteAssignment &definite) {
+    Liveness(plan, constants, definite, dead).run();
+}
+
+bool DeadCode::isDead(Statement *stmt) const {
+    return dead.count(stmt) != 0;
+}
+
+int DeadCode::size() const {
+    return dead.size();
+}
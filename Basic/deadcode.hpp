@@ -0,0 +1,74 @@
+/*
+ * File: deadcode.h
+ * ----------------
+ * This interface exports the DeadCode class, which finds the
+ * statements of an ExecutionPlan that the bytecode compiler can leave
+ * out without changing what the program prints or the variables it
+ * leaves behind.
+ */
+
+#ifndef _deadcode_h
+#define _deadcode_h
+
+#include <unordered_set>
+#include "constprop.hpp"
+#include "definite.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: DeadCode
+ * ---------------
+ * A statement is dead if no path from the first line reaches it, or if
+ * it is a LET whose value is never read: every path from it assigns
+ * the variable again before reading it.  A dead LET must also be unable
+ * to raise an error and contain no assignment, since dropping it would
+ * otherwise drop that effect.
+ *
+ * Variables outlive a RUN, so every variable is live wherever the
+ * program can stop: at END, at the end of the program, at a jump to
+ * line 0, and at any statement that may raise an error.  A read may
+ * fail unless DefiniteAssignment or ConstantPropagation proved the
+ * variable assigned there.
+ */
+
+class DeadCode {
+
+public:
+
+/*
+ * Constructor: DeadCode
+ * Usage: DeadCode dead(plan, constants, definite);
+ * ------------------------------------------------
+ * Runs the analysis over plan, using the results of constant
+ * propagation and definite assignment over the same plan to tell
+ * which expressions cannot fail.
+ */
+
+    DeadCode(const ExecutionPlan &plan, const ConstantPropagation &constants,
+             const DefiniteAssignment &definite);
+
+/*
+ * Method: isDead
+ * Usage: if (dead.isDead(stmt)) . . .
+ * -----------------------------------
+ * Returns true if stmt, one of the plan's statements, can be dropped.
+ */
+
+    bool isDead(Statement *stmt) const;
+
+/*
+ * Method: size
+ * Usage: int count = dead.size();
+ * -------------------------------
+ * Returns the number of dead statements.
+ */
+
+    int size() const;
+
+private:
+
+    std::unordered_set<Statement *> dead;
+
+};
+
+#endif
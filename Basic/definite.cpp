@@ -0,0 +1,234 @@
+/*
+ * File: definite.cpp
+ * ------------------
+ * This file implements the DefiniteAssignment class.
+ */
+
+#include "definite.hpp"
+#include "cfg.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+/*
+ * Type: VariableSet
+ * -----------------
+ * A set of variables, one bit per variable number.
+ */
+
+typedef std::vector<unsigned long long> VariableSet;
+
+/*
+ * Class: Analyzer
+ * ---------------
+ * Holds the variable numbering and the sets of assigned variables at
+ * block entries while the analysis runs.
+ */
+
+class Analyzer {
+
+public:
+
+    Analyzer(const ExecutionPlan &plan, std::unordered_set<Expression *> &defined)
+            : plan(plan), defined(defined) {
+    }
+
+    void run();
+
+private:
+
+    int variable(const std::string &name);
+    void collect(Expression *exp);
+    void transfer(int block, VariableSet &assigned);
+    void eval(Expression *exp, VariableSet &assigned);
+    void assign(const std::string &name, VariableSet &assigned);
+
+    const ExecutionPlan &plan;
+    std::unordered_set<Expression *> &defined;
+    std::map<std::string, int> variables;
+    std::vector<VariableSet> entries;
+    bool recording = false;
+
+};
+
+int Analyzer::variable(const std::string &name) {
+    auto it = variables.find(name);
+    if (it != variables.end()) return it->second;
+    int index = variables.size();
+    variables.emplace(name, index);
+    return index;
+}
+
+void Analyzer::collect(Expression *exp) {
+    if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getName());
+    } else if (exp->getType() == COMPOUND) {
+        collect(((CompoundExp *) exp)->getLHS());
+        collect(((CompoundExp *) exp)->getRHS());
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * A forward must-analysis over the blocks the ControlFlowGraph finds
+ * reachable: the set at a block entry is the intersection of the sets
+ * leaving its predecessors.  Every set but the first starts full and
+ * only shrinks, so the worklist, which starts with every reachable
+ * block, empties after a few passes over each.  The first block always
+ * starts from the empty set, even when a loop jumps back to it.  A
+ * last pass over the reachable blocks records the reads.
+ */
+
+void Analyzer::run() {
+    int count = plan.getBlockCount();
+    if (count == 0) return;
+    for (int i = 0; i < plan.size(); i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET:
+                variable(((LetStmt *) stmt)->getVar());
+                collect(((LetStmt *) stmt)->getExp());
+                break;
+            case PRINT:
+                collect(((PrintStmt *) stmt)->getExp());
+                break;
+            case INPUT:
+                variable(((InputStmt *) stmt)->getVar());
+                break;
+            case IF:
+                collect(((IfStmt *) stmt)->getLHS());
+                collect(((IfStmt *) stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    int words = (variables.size() + 63) / 64;
+    const ControlFlowGraph &cfg = plan.getControlFlowGraph();
+    entries.assign(count, VariableSet(words, ~0ULL));
+    entries[0].assign(words, 0);
+    std::vector<int> worklist;
+    std::vector<char> queued(count, false);
+    for (int block = count - 1; block >= 0; block--) {
+        if (!cfg.isReachable(block)) continue;
+        queued[block] = true;
+        worklist.push_back(block);
+    }
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        queued[block] = false;
+        VariableSet assigned = entries[block];
+        transfer(block, assigned);
+        for (int successor : plan.getBlock(block).successors) {
+            if (successor == 0) continue;
+            VariableSet &entry = entries[successor];
+            bool changed = false;
+            for (int w = 0; w < words; w++) {
+                unsigned long long meet = entry[w] & assigned[w];
+                if (meet != entry[w]) {
+                    entry[w] = meet;
+                    changed = true;
+                }
+            }
+            if (changed && !queued[successor]) {
+                queued[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+    recording = true;
+    for (int block = 0; block < count; block++) {
+        if (!cfg.isReachable(block)) continue;
+        VariableSet assigned = entries[block];
+        transfer(block, assigned);
+    }
+}
+
+/*
+ * Implementation notes: transfer
+ * ------------------------------
+ * Runs the statements of a block over assigned.  Expressions are
+ * walked left to right, as CompoundExp::eval runs them, so that an
+ * assignment inside an expression covers the reads after it.  Nothing
+ * needs to be special about a statement that fails: the program stops
+ * there, so whatever is claimed after it is never put to the test.
+ */
+
+void Analyzer::transfer(int block, VariableSet &assigned) {
+    const BasicBlock &range = plan.getBlock(block);
+    for (int i = range.first; i <= range.last; i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET: {
+                LetStmt *let = (LetStmt *) stmt;
+                eval(let->getExp(), assigned);
+                assign(let->getVar(), assigned);
+                break;
+            }
+            case PRINT:
+                eval(((PrintStmt *) stmt)->getExp(), assigned);
+                break;
+            case INPUT:
+                assign(((InputStmt *) stmt)->getVar(), assigned);
+                break;
+            case IF:
+                eval(((IfStmt *) stmt)->getLHS(), assigned);
+                eval(((IfStmt *) stmt)->getRHS(), assigned);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Analyzer::eval(Expression *exp, VariableSet &assigned) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            break;
+        case IDENTIFIER: {
+            int index = variable(((IdentifierExp *) exp)->getName());
+            unsigned long long bit = 1ULL << (index % 64);
+            if (recording && (assigned[index / 64] & bit)) defined.insert(exp);
+            assigned[index / 64] |= bit;
+            break;
+        }
+        case COMPOUND: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            Expression *lhs = compound->getLHS();
+            if (compound->getOp() == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") break;
+                eval(compound->getRHS(), assigned);
+                assign(((IdentifierExp *) lhs)->getName(), assigned);
+                break;
+            }
+            eval(lhs, assigned);
+            eval(compound->getRHS(), assigned);
+            break;
+        }
+    }
+}
+
+void Analyzer::assign(const std::string &name, VariableSet &assigned) {
+    int index = variable(name);
+    assigned[index / 64] |= 1ULL << (index % 64);
+}
+
+}
+
+DefiniteAssignment::DefiniteAssignment(const ExecutionPlan &plan) {
+    Analyzer(plan, defined).run();
+}
+
+bool DefiniteAssignment::isDefined(Expression *exp) const {
+    return defined.count(exp) != 0;
+}
+
+int DefiniteAssignment::size() const {
+    return defined.size();
+}
@@ -0,0 +1,67 @@
+/*
+ * File: definite.h
+ * ----------------
+ * This interface exports the DefiniteAssignment class, a dataflow
+ * analysis over the basic blocks of an ExecutionPlan that finds the
+ * variable reads that can never raise VARIABLE NOT DEFINED.
+ */
+
+#ifndef _definite_h
+#define _definite_h
+
+#include <unordered_set>
+#include "exp.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: DefiniteAssignment
+ * -------------------------
+ * A variable is definitely assigned at a point if every path from the
+ * start of the program to that point assigns it, by LET, INPUT or an
+ * assignment inside an expression, or reads it.  A read that finds the
+ * variable unset stops the program, so every read that lets control
+ * go on counts as well.  Since the EvalState survives from one RUN to
+ * the next, nothing is known about any variable at the start.
+ */
+
+class DefiniteAssignment {
+
+public:
+
+/*
+ * Constructor: DefiniteAssignment
+ * Usage: DefiniteAssignment definite(plan);
+ * -----------------------------------------
+ * Runs the analysis over plan.  The results refer to the Expression
+ * objects of the plan's statements and stay valid until the program
+ * is edited.
+ */
+
+    explicit DefiniteAssignment(const ExecutionPlan &plan);
+
+/*
+ * Method: isDefined
+ * Usage: if (definite.isDefined(exp)) . . .
+ * -----------------------------------------
+ * Returns true if exp is an IdentifierExp of the plan whose variable
+ * is definitely assigned whenever it is read.
+ */
+
+    bool isDefined(Expression *exp) const;
+
+/*
+ * Method: size
+ * Usage: int count = definite.size();
+ * -----------------------------------
+ * Returns the number of reads that need no check.
+ */
+
+    int size() const;
+
+private:
+
+    std::unordered_set<Expression *> defined;
+
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 
 #include "evalstate.hpp"
+#include <algorithm>
 
 
 //using namespace std;
@@ -23,19 +24,33 @@ EvalState::~EvalState() {
 }
 
 void EvalState::setValue(std::string var, int value) {
-    if(isDefined(var)) symbolTable[var] = value;
-    else symbolTable.emplace(var,value);
+    setSlotValue(getSlot(var), value);
 }
 
 int EvalState::getValue(std::string var) {
-    if(isDefined(var)) return symbolTable[var];
+    auto it = slotTable.find(var);
+    if (it != slotTable.end() && defined[it->second]) return values[it->second];
     else return 0;
 }
 
 bool EvalState::isDefined(std::string var) {
-    return symbolTable.find(var)!=symbolTable.end();
+    auto it = slotTable.find(var);
+    return it != slotTable.end() && defined[it->second];
 }
 
 void EvalState::Clear() {
-    symbolTable.clear();
-}
\ No newline at end of file
+    std::fill(defined.begin(), defined.end(), false);
+    touchAllSlots();
+}
+
+int EvalState::getSlot(const std::string &var) {
+    auto it = slotTable.find(var);
+    if (it != slotTable.end()) return it->second;
+    int slot = values.size();
+    slotTable.emplace(var, slot);
+    names.push_back(var);
+    values.push_back(0);
+    defined.push_back(false);
+    versions.push_back(0);
+    return slot;
+}
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 /*
  * Class: EvalState
@@ -75,9 +76,116 @@ public:
 
     void Clear();
 
+/*
+ * Method: getSlot
+ * Usage: int slot = state.getSlot(var);
+ * -------------------------------------
+ * Returns the index of the storage slot bound to the specified var,
+ * allocating a new undefined slot the first time a name is seen.
+ * Slots are never released (Clear only undefines them), so compiled
+ * code may hold on to slot indices for the life of the state.
+ */
+
+    int getSlot(const std::string &var);
+
+/*
+ * Method: getSlotName
+ * Usage: string var = state.getSlotName(slot);
+ * --------------------------------------------
+ * Returns the name of the variable bound to slot.
+ */
+
+    const std::string &getSlotName(int slot) const {
+        return names[slot];
+    }
+
+/*
+ * Method: getSlotCount
+ * Usage: int count = state.getSlotCount();
+ * ----------------------------------------
+ * Returns the number of slots allocated so far.
+ */
+
+    int getSlotCount() const {
+        return values.size();
+    }
+
+/*
+ * Methods: isSlotDefined, getSlotValue, setSlotValue
+ * Usage: if (state.isSlotDefined(slot)) . . .
+ *        int value = state.getSlotValue(slot);
+ *        state.setSlotValue(slot, value);
+ * --------------------------------------------
+ * These methods are the slot-indexed counterparts of isDefined,
+ * getValue and setValue.  They are defined inline because they sit
+ * on the hot path of the bytecode interpreter.
+ */
+
+    bool isSlotDefined(int slot) const {
+        return defined[slot];
+    }
+
+    int getSlotValue(int slot) const {
+        return values[slot];
+    }
+
+    void setSlotValue(int slot, int value) {
+        values[slot] = value;
+        defined[slot] = true;
+        versions[slot]++;
+    }
+
+/*
+ * Methods: getSlotVersion, getEpoch, touchAllSlots
+ * Usage: unsigned version = state.getSlotVersion(slot);
+ *        unsigned epoch = state.getEpoch();
+ *        state.touchAllSlots();
+ * ----------------------------------------------------
+ * Every store through setSlotValue advances the version of its slot,
+ * so a value computed from some slots is still valid as long as their
+ * versions and the epoch are the same as when it was computed.  Code
+ * that writes the slot arrays directly, and Clear, advance the epoch
+ * instead, which counts as a store to every slot.
+ */
+
+    unsigned getSlotVersion(int slot) const {
+        return versions[slot];
+    }
+
+    unsigned getEpoch() const {
+        return epoch;
+    }
+
+    void touchAllSlots() {
+        epoch++;
+    }
+
+/*
+ * Methods: getValueArray, getDefinedArray
+ * Usage: int *values = state.getValueArray();
+ * -------------------------------------------
+ * Return the raw slot storage for native code, which indexes it
+ * directly.  The pointers stay valid until the next new slot is
+ * allocated by getSlot.  Code that stores through them must call
+ * touchAllSlots.
+ */
+
+    int *getValueArray() {
+        return values.data();
+    }
+
+    char *getDefinedArray() {
+        return defined.data();
+    }
+
 private:
 
-    std::map<std::string, int> symbolTable;
+    std::map<std::string, int> slotTable;
+    std::vector<std::string> names;
+    std::vector<int> values;
+    std::vector<char> defined;
+    std::vector<unsigned> versions;
+    unsigned epoch = 0;
 
 };
 
@@ -144,3 +144,11 @@ Expression *CompoundExp::getRHS() {
     return rhs;
 }
 
+void CompoundExp::setLHS(Expression *lhs) {
+    this->lhs = lhs;
+}
+
+void CompoundExp::setRHS(Expression *rhs) {
+    this->rhs = rhs;
+}
+
@@ -259,6 +259,19 @@ public:
 
     Expression *getRHS();
 
+/*
+ * Methods: setLHS, setRHS
+ * Usage: ((CompoundExp *) exp)->setLHS(lhs);
+ * ------------------------------------------
+ * Replace a subexpression, which lets a pass such as foldConstants
+ * rewrite a tree in place.  The old subexpression is not freed, so a
+ * caller that moves it elsewhere can detach it by setting nullptr.
+ */
+
+    void setLHS(Expression *lhs);
+
+    void setRHS(Expression *rhs);
+
 private:
 
     std::string op;
@@ -0,0 +1,174 @@
+/*
+ * File: fold.cpp
+ * --------------
+ * This file implements the foldConstants pass declared in fold.h.
+ */
+
+#include "fold.hpp"
+#include <climits>
+
+namespace {
+
+/*
+ * Implementation notes: wrapping arithmetic
+ * -----------------------------------------
+ * Folding must give the values the interpreter computes at run time,
+ * where int arithmetic wraps around.  Doing the arithmetic in unsigned
+ * gives the same bits without the undefined behavior of signed
+ * overflow in the compiler itself.
+ */
+
+int wrapAdd(int a, int b) {
+    return (int) ((unsigned) a + (unsigned) b);
+}
+
+int wrapSub(int a, int b) {
+    return (int) ((unsigned) a - (unsigned) b);
+}
+
+int wrapMul(int a, int b) {
+    return (int) ((unsigned) a * (unsigned) b);
+}
+
+bool isConstant(Expression *exp) {
+    return exp->getType() == CONSTANT;
+}
+
+int valueOf(Expression *exp) {
+    return ((ConstantExp *) exp)->getValue();
+}
+
+/*
+ * Function: isPure
+ * ----------------
+ * Returns true if evaluating exp can neither raise an error nor
+ * assign a variable.
+ */
+
+bool isPure(Expression *exp, const std::set<std::string> *defined) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return true;
+        case IDENTIFIER:
+            return defined != nullptr && defined->count(((IdentifierExp *) exp)->getName()) > 0;
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            if (op == "=") return false;
+            if (op == "/") {
+                Expression *rhs = compound->getRHS();
+                if (!isConstant(rhs) || valueOf(rhs) == 0 || valueOf(rhs) == -1) return false;
+                return isPure(compound->getLHS(), defined);
+            }
+            return isPure(compound->getLHS(), defined) && isPure(compound->getRHS(), defined);
+        }
+    }
+}
+
+/*
+ * Functions: keepLHS, replaceByConstant
+ * -------------------------------------
+ * Free node and return what replaces it.  keepLHS detaches the left
+ * subexpression first so that it survives.
+ */
+
+Expression *keepLHS(CompoundExp *node) {
+    Expression *lhs = node->getLHS();
+    node->setLHS(nullptr);
+    delete node;
+    return lhs;
+}
+
+Expression *replaceByConstant(CompoundExp *node, int value) {
+    delete node;
+    return new ConstantExp(value);
+}
+
+/*
+ * Function: offsetExp
+ * -------------------
+ * Returns x + offset in the form a programmer would write it.
+ */
+
+Expression *offsetExp(Expression *x, int offset) {
+    if (offset < 0 && offset != INT_MIN) {
+        return new CompoundExp("-", x, new ConstantExp(-offset));
+    }
+    return new CompoundExp("+", x, new ConstantExp(offset));
+}
+
+Expression *simplify(CompoundExp *node, const std::set<std::string> *defined);
+
+/*
+ * Function: merge
+ * ---------------
+ * Handles node = inner op c, where inner = x innerOp c1 and both
+ * operators belong to the same family.  x is still evaluated exactly
+ * once and the constants cannot fail, so the merged node behaves the
+ * same; wrapping arithmetic makes the regrouping exact.  Returns
+ * nullptr if the operators do not combine.
+ */
+
+Expression *merge(CompoundExp *node, const std::set<std::string> *defined) {
+    CompoundExp *inner = (CompoundExp *) node->getLHS();
+    std::string op = node->getOp(), innerOp = inner->getOp();
+    int c = valueOf(node->getRHS()), c1 = valueOf(inner->getRHS());
+    bool additive = (op == "+" || op == "-") && (innerOp == "+" || innerOp == "-");
+    bool multiplicative = op == "*" && innerOp == "*";
+    if (!additive && !multiplicative) return nullptr;
+    Expression *x = inner->getLHS();
+    inner->setLHS(nullptr);
+    delete node;
+    if (multiplicative) {
+        return simplify(new CompoundExp("*", x, new ConstantExp(wrapMul(c1, c))), defined);
+    }
+    int offset = wrapAdd(innerOp == "+" ? c1 : wrapSub(0, c1), op == "+" ? c : wrapSub(0, c));
+    return simplify((CompoundExp *) offsetExp(x, offset), defined);
+}
+
+/*
+ * Function: simplify
+ * ------------------
+ * Simplifies an arithmetic node whose subexpressions are already
+ * folded.
+ */
+
+Expression *simplify(CompoundExp *node, const std::set<std::string> *defined) {
+    std::string op = node->getOp();
+    Expression *lhs = node->getLHS();
+    Expression *rhs = node->getRHS();
+    if (isConstant(lhs) && isConstant(rhs)) {
+        int a = valueOf(lhs), b = valueOf(rhs);
+        if (op == "+") return replaceByConstant(node, wrapAdd(a, b));
+        if (op == "-") return replaceByConstant(node, wrapSub(a, b));
+        if (op == "*") return replaceByConstant(node, wrapMul(a, b));
+        if (b == 0 || (a == INT_MIN && b == -1)) return node;
+        return replaceByConstant(node, a / b);
+    }
+    if ((op == "+" || op == "*") && isConstant(lhs)) {
+        node->setLHS(rhs);
+        node->setRHS(lhs);
+        std::swap(lhs, rhs);
+    }
+    if (!isConstant(rhs)) return node;
+    int c = valueOf(rhs);
+    if ((op == "+" || op == "-") && c == 0) return keepLHS(node);
+    if ((op == "*" || op == "/") && c == 1) return keepLHS(node);
+    if (op == "*" && c == 0 && isPure(lhs, defined)) return replaceByConstant(node, 0);
+    if (lhs->getType() == COMPOUND && isConstant(((CompoundExp *) lhs)->getRHS())) {
+        Expression *merged = merge(node, defined);
+        if (merged != nullptr) return merged;
+    }
+    return node;
+}
+
+}
+
+Expression *foldConstants(Expression *exp, const std::set<std::string> *defined) {
+    if (exp->getType() != COMPOUND) return exp;
+    CompoundExp *node = (CompoundExp *) exp;
+    node->setRHS(foldConstants(node->getRHS(), defined));
+    if (node->getOp() == "=") return node;
+    node->setLHS(foldConstants(node->getLHS(), defined));
+    return simplify(node, defined);
+}
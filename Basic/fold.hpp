@@ -0,0 +1,41 @@
+/*
+ * File: fold.h
+ * ------------
+ * This interface exports foldConstants, the simplification pass that
+ * parseExp applies to every expression it reads, so that every
+ * backend starts from the smaller tree.
+ */
+
+#ifndef _fold_h
+#define _fold_h
+
+#include <set>
+#include <string>
+#include "exp.hpp"
+
+/*
+ * Function: foldConstants
+ * Usage: exp = foldConstants(exp);
+ *        exp = foldConstants(exp, &defined);
+ * ------------------------------------------
+ * Simplifies exp and returns the result, which takes the place of exp;
+ * nodes that are dropped are freed.  For every state the result has
+ * the same value as exp, wrapping around as int arithmetic does at run
+ * time, and raises the same errors in the same order.  The pass
+ *
+ *  - folds an operator whose operands are both constants, except a
+ *    division that fails at run time, which is kept so that it still
+ *    raises DIVIDE BY ZERO when executed;
+ *  - moves a constant operand of + or * to the right, and merges
+ *    chains such as (X + 1) - 3 into X - 2 and (X * 2) * 3 into X * 6;
+ *  - removes x + 0, x - 0, x * 1 and x / 1;
+ *  - replaces x * 0 by 0 when evaluating x can neither fail nor assign,
+ *    which requires every variable in x to be listed in defined.
+ *
+ * The left side of an assignment is never touched, so an invalid
+ * target still raises SYNTAX ERROR.
+ */
+
+Expression *foldConstants(Expression *exp, const std::set<std::string> *defined = nullptr);
+
+#endif
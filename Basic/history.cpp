@@ -0,0 +1,429 @@
+/*
+ * File: history.cpp
+ * -----------------
+ * This file implements the ExecutionHistory and OutputCapture classes.
+ */
+
+#include "history.hpp"
+#include <algorithm>
+#include <iostream>
+
+/*
+ * Implementation notes: resume
+ * ----------------------------
+ * Checkpoints are kept in clock order, and a checkpoint is valid if
+ * the edits, and every variable read before being assigned whose value
+ * is not the one the recorded RUN started with, only come into play
+ * after it.  Resuming drops what was recorded after the checkpoint, so
+ * that the history describes this RUN as it goes on, and this RUN's
+ * variables become the start.  The stamps move to the lines of the new
+ * plan; a line the edits entered or deleted was stamped after the
+ * checkpoint, if at all.
+ */
+
+bool ExecutionHistory::resume(const ExecutionPlan &plan, EvalState &state, int &step) {
+    if (checkpoints.empty()) return false;
+    int limit = horizon;
+    for (int slot = 0; slot < (int) readAt.size(); slot++) {
+        if (readAt[slot] < limit && !sameAsStart(slot, state)) limit = readAt[slot];
+    }
+    int last = -1;
+    for (int i = 0; i < (int) checkpoints.size() && checkpoints[i].time < limit; i++) {
+        last = i;
+    }
+    if (last == -1) return false;
+    int index = plan.findStep(checkpoints[last].lineNumber);
+    if (index == END_OF_PLAN) return false;
+    checkpoints.resize(last + 1);
+    const Checkpoint &checkpoint = checkpoints.back();
+    std::vector<int> oldLines, oldNamedAt, oldRanAt;
+    oldLines.swap(lines);
+    oldNamedAt.swap(namedAt);
+    oldRanAt.swap(ranAt);
+    setLines(plan);
+    size_t old = 0;
+    for (int i = 0; i < plan.size(); i++) {
+        while (old < oldLines.size() && oldLines[old] < lines[i]) old++;
+        if (old == oldLines.size() || oldLines[old] != lines[i]) continue;
+        if (oldNamedAt[old] <= checkpoint.time) namedAt[i] = oldNamedAt[old];
+        if (oldRanAt[old] <= checkpoint.time) ranAt[i] = oldRanAt[old];
+    }
+    for (auto it = missing.begin(); it != missing.end();) {
+        if (it->second > checkpoint.time) {
+            it = missing.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int &time : readAt) {
+        if (time > checkpoint.time) time = INT_MAX;
+    }
+    for (int &time : writtenAt) {
+        if (time > checkpoint.time) time = INT_MAX;
+    }
+    output.resize(checkpoint.output);
+    std::cout.write(output.data(), output.size());
+    save(start, state);
+    restore(checkpoint, state);
+    clock = checkpoint.time + 1;
+    horizon = INT_MAX;
+    since = 0;
+    recording = true;
+    seen.assign(plan.size(), false);
+    step = index;
+    return true;
+}
+
+/*
+ * Implementation notes: begin
+ * ---------------------------
+ * The first line counts as run from the start, so entering a line
+ * in front of it, where RUN would begin instead, invalidates every
+ * checkpoint.
+ */
+
+void ExecutionHistory::begin(const ExecutionPlan &plan, EvalState &state) {
+    checkpoints.clear();
+    missing.clear();
+    readAt.clear();
+    writtenAt.clear();
+    output.clear();
+    save(start, state);
+    setLines(plan);
+    clock = 0;
+    horizon = INT_MAX;
+    interval = CHECKPOINT_INTERVAL;
+    since = interval;
+    recording = plan.size() > 0;
+    seen.assign(plan.size(), false);
+    if (recording) namedAt[0] = ranAt[0] = clock;
+}
+
+void ExecutionHistory::setLines(const ExecutionPlan &plan) {
+    lines.resize(plan.size());
+    for (int i = 0; i < plan.size(); i++) {
+        lines[i] = plan.getStep(i).lineNumber;
+    }
+    namedAt.assign(plan.size(), INT_MAX);
+    ranAt.assign(plan.size(), INT_MAX);
+}
+
+/*
+ * Implementation notes: addPrefix
+ * -------------------------------
+ * The step the evaluator stopped in front of is left for the walker,
+ * which sees what it reads.
+ */
+
+void ExecutionHistory::addPrefix(const ExecutionPlan &plan, const PartialEvaluation &partial,
+                                 EvalState &state) {
+    for (int i = 0; i < plan.size(); i++) {
+        if (!partial.hasRun(i) || i == partial.getResumeStep() || seen[i]) continue;
+        use(plan.getStep(i).stmt, state, false, true);
+        touch(plan, i);
+    }
+}
+
+/*
+ * Implementation notes: visit
+ * ---------------------------
+ * The checkpoint is taken before the step is stamped, so that the
+ * step itself, and an edit of it, belongs to the time after it.  When
+ * the checkpoints run out every other one is dropped; the first one
+ * always stays.
+ */
+
+void ExecutionHistory::visit(const ExecutionPlan &plan, int step, EvalState &state) {
+    if (!recording) return;
+    if (++since >= interval && plan.getStep(step).leader) {
+        if ((int) checkpoints.size() == MAX_CHECKPOINTS) {
+            size_t kept = 0;
+            for (size_t i = 0; i < checkpoints.size(); i += 2) {
+                checkpoints[kept++] = std::move(checkpoints[i]);
+            }
+            checkpoints.resize(kept);
+            interval *= 2;
+        }
+        checkpoints.emplace_back();
+        Checkpoint &checkpoint = checkpoints.back();
+        checkpoint.time = clock++;
+        checkpoint.lineNumber = plan.getStep(step).lineNumber;
+        save(checkpoint, state);
+        since = 0;
+    }
+    if (!seen[step]) {
+        use(plan.getStep(step).stmt, state, true, true);
+        touch(plan, step);
+    }
+}
+
+void ExecutionHistory::enterRegion(const ExecutionPlan &plan, int firstLine, int lastLine,
+                                   EvalState &state) {
+    if (!recording) return;
+    since += CHECKPOINT_INTERVAL;
+    int first = plan.findStep(firstLine), last = plan.findStep(lastLine);
+    if (first == END_OF_PLAN || last == END_OF_PLAN) return;
+    for (int i = first; i <= last; i++) {
+        if (!seen[i]) use(plan.getStep(i).stmt, state, true, false);
+    }
+    for (int i = first; i <= last; i++) {
+        if (seen[i]) continue;
+        use(plan.getStep(i).stmt, state, false, true);
+        touch(plan, i);
+    }
+}
+
+/*
+ * Implementation notes: edit
+ * --------------------------
+ * Replacing or deleting a line only matters once control reaches it;
+ * a jump that names a deleted line only fails when it is taken.  A new
+ * line matters when a jump names it, or when the line before it falls
+ * through to the line after it, which is no earlier than the time both
+ * of them have run.  If the line after ran last, a checkpoint taken as
+ * it was first reached is one tick older than its stamp, and would
+ * resume past the new line.  A loop that ends in an IF names the line
+ * after it on its first pass, but only runs it once it is done, so an
+ * edit just past the loop leaves its checkpoints valid.
+ *
+ * The lines before and after are taken from the recorded plan.
+ * Earlier edits may have entered or deleted lines in between, but then
+ * the checkpoints they leave valid are older than those lines ran.  A
+ * line in front of the first line changes where RUN begins.
+ */
+
+void ExecutionHistory::edit(int lineNumber) {
+    if (checkpoints.empty()) return;
+    auto it = std::lower_bound(lines.begin(), lines.end(), lineNumber);
+    int index = it - lines.begin();
+    int time;
+    if (it != lines.end() && *it == lineNumber) {
+        time = ranAt[index];
+    } else if (index == 0) {
+        time = 0;
+    } else {
+        time = ranAt[index - 1];
+        if (it != lines.end() && ranAt[index] > time) {
+            time = ranAt[index];
+            auto taken = std::lower_bound(checkpoints.begin(), checkpoints.end(), time - 1,
+                                          [](const Checkpoint &checkpoint, int t) {
+                                              return checkpoint.time < t;
+                                          });
+            if (taken != checkpoints.end() && taken->time == time - 1
+                && taken->lineNumber == *it) {
+                time--;
+            }
+        }
+    }
+    auto found = missing.find(lineNumber);
+    if (found != missing.end()) time = std::min(time, found->second);
+    horizon = std::min(horizon, time);
+}
+
+void ExecutionHistory::clear() {
+    checkpoints.clear();
+    lines.clear();
+    namedAt.clear();
+    ranAt.clear();
+    missing.clear();
+    readAt.clear();
+    writtenAt.clear();
+    output.clear();
+    recording = false;
+}
+
+void ExecutionHistory::write(const char *data, size_t count) {
+    if (!recording) return;
+    if (output.size() + count > MAX_OUTPUT) {
+        recording = false;
+        return;
+    }
+    output.append(data, count);
+}
+
+/*
+ * Implementation notes: save
+ * --------------------------
+ * std::cout is flushed first, so that the output OutputCapture still
+ * buffers is counted.
+ */
+
+void ExecutionHistory::save(Checkpoint &checkpoint, EvalState &state) {
+    std::cout.flush();
+    checkpoint.output = output.size();
+    int slots = state.getSlotCount();
+    checkpoint.values.assign(state.getValueArray(), state.getValueArray() + slots);
+    checkpoint.defined.assign(state.getDefinedArray(), state.getDefinedArray() + slots);
+}
+
+/*
+ * Implementation notes: sameAsStart, restore
+ * ------------------------------------------
+ * A slot allocated after the start was saved belongs to a variable
+ * that had no value then.  Only the variables assigned before the
+ * checkpoint are restored; the others still hold what they held when
+ * this RUN started, as they would have at the checkpoint.
+ */
+
+bool ExecutionHistory::sameAsStart(int slot, EvalState &state) const {
+    bool saved = slot < (int) start.defined.size() && start.defined[slot];
+    bool current = slot < state.getSlotCount() && state.isSlotDefined(slot);
+    if (saved != current) return false;
+    return !saved || start.values[slot] == state.getSlotValue(slot);
+}
+
+void ExecutionHistory::restore(const Checkpoint &checkpoint, EvalState &state) {
+    int *values = state.getValueArray();
+    char *defined = state.getDefinedArray();
+    state.touchAllSlots();
+    for (int slot = 0; slot < (int) writtenAt.size(); slot++) {
+        if (writtenAt[slot] > checkpoint.time) continue;
+        bool saved = slot < (int) checkpoint.defined.size();
+        values[slot] = saved ? checkpoint.values[slot] : 0;
+        defined[slot] = saved && checkpoint.defined[slot];
+    }
+}
+
+/*
+ * Implementation notes: touch, follow
+ * -----------------------------------
+ * A step runs its own line and names the line its jump names and the
+ * line it falls through to.  The plan has threaded its jumps past REMs
+ * and GOTOs that only pass control on, so follow walks such a chain
+ * line by line.  The walker never sees the lines on the chain, so they
+ * count as run as soon as they are named; the line the chain ends at
+ * only counts as run when the walker gets there.  A chain stops at a
+ * line that is already named, whose chain has been walked before,
+ * which keeps the work linear.
+ */
+
+void ExecutionHistory::touch(const ExecutionPlan &plan, int step) {
+    seen[step] = true;
+    const PlanStep &current = plan.getStep(step);
+    namedAt[step] = std::min(namedAt[step], clock);
+    ranAt[step] = std::min(ranAt[step], clock);
+    StatementType type = current.stmt == nullptr ? REM : current.stmt->getType();
+    if (type == INPUT) recording = false;
+    if (type == GOTO) follow(plan, ((GotoStmt *) current.stmt)->getLineNumber());
+    if (type == IF) follow(plan, ((IfStmt *) current.stmt)->getLineNumber());
+    if (type != GOTO && type != END && step + 1 < plan.size()) {
+        follow(plan, plan.getStep(step + 1).lineNumber);
+    }
+}
+
+void ExecutionHistory::follow(const ExecutionPlan &plan, int lineNumber) {
+    while (true) {
+        int index = plan.findStep(lineNumber);
+        if (index == END_OF_PLAN) {
+            missing.emplace(lineNumber, clock);
+            return;
+        }
+        if (namedAt[index] != INT_MAX) return;
+        namedAt[index] = clock;
+        const PlanStep &step = plan.getStep(index);
+        StatementType type = step.stmt == nullptr ? REM : step.stmt->getType();
+        if (type != REM && type != GOTO) return;
+        ranAt[index] = std::min(ranAt[index], clock);
+        if (type == GOTO) {
+            lineNumber = ((GotoStmt *) step.stmt)->getLineNumber();
+        } else if (index + 1 < plan.size()) {
+            lineNumber = lines[index + 1];
+        } else {
+            return;
+        }
+    }
+}
+
+/*
+ * Implementation notes: use, useExp
+ * ---------------------------------
+ * Stamps the variables stmt reads that have not been assigned yet, if
+ * reads is set, and the variables it assigns, if writes is set.  A
+ * nested assignment counts as coming after every read of the
+ * statement, which can only stamp more reads.
+ */
+
+void ExecutionHistory::use(Statement *stmt, EvalState &state, bool reads, bool writes) {
+    if (stmt == nullptr) return;
+    switch (stmt->getType()) {
+        case LET: {
+            LetStmt *let = (LetStmt *) stmt;
+            useExp(let->getExp(), state, reads, writes);
+            if (writes) stamp(writtenAt, state.getSlot(let->getVar()));
+            break;
+        }
+        case PRINT: {
+            Expression *exp = ((PrintStmt *) stmt)->getExp();
+            if (exp != nullptr) useExp(exp, state, reads, writes);
+            break;
+        }
+        case INPUT:
+            if (writes) stamp(writtenAt, state.getSlot(((InputStmt *) stmt)->getVar()));
+            break;
+        case IF:
+            useExp(((IfStmt *) stmt)->getLHS(), state, reads, writes);
+            useExp(((IfStmt *) stmt)->getRHS(), state, reads, writes);
+            break;
+        default:
+            break;
+    }
+}
+
+void ExecutionHistory::useExp(Expression *exp, EvalState &state, bool reads, bool writes) {
+    if (exp->getType() == IDENTIFIER) {
+        int slot = state.getSlot(((IdentifierExp *) exp)->getName());
+        if (reads && (slot >= (int) writtenAt.size() || writtenAt[slot] == INT_MAX)) {
+            stamp(readAt, slot);
+        }
+    } else if (exp->getType() == COMPOUND) {
+        CompoundExp *compound = (CompoundExp *) exp;
+        Expression *lhs = compound->getLHS();
+        if (compound->getOp() == "=" && lhs->getType() == IDENTIFIER) {
+            useExp(compound->getRHS(), state, reads, writes);
+            if (writes) stamp(writtenAt, state.getSlot(((IdentifierExp *) lhs)->getName()));
+        } else {
+            useExp(lhs, state, reads, writes);
+            useExp(compound->getRHS(), state, reads, writes);
+        }
+    }
+}
+
+void ExecutionHistory::stamp(std::vector<int> &times, int slot) {
+    if (slot >= (int) times.size()) times.resize(slot + 1, INT_MAX);
+    times[slot] = std::min(times[slot], clock);
+}
+
+OutputCapture::OutputCapture(ExecutionHistory *history) : history(history) {
+    if (history == nullptr) return;
+    target = std::cout.rdbuf(this);
+    setp(buffer, buffer + BUFFER_SIZE);
+}
+
+OutputCapture::~OutputCapture() {
+    if (target == nullptr) return;
+    drain();
+    std::cout.rdbuf(target);
+}
+
+int OutputCapture::overflow(int c) {
+    drain();
+    if (c != traits_type::eof()) {
+        *pptr() = c;
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int OutputCapture::sync() {
+    drain();
+    return target->pubsync();
+}
+
+void OutputCapture::drain() {
+    std::streamsize count = pptr() - pbase();
+    if (count > 0) {
+        target->sputn(pbase(), count);
+        history->write(pbase(), count);
+    }
+    setp(buffer, buffer + BUFFER_SIZE);
+}
@@ -0,0 +1,246 @@
+/*
+ * File: history.h
+ * ---------------
+ * This interface exports the ExecutionHistory class, which records
+ * checkpoints of a RUN so that the next RUN after an edit can resume
+ * from the last checkpoint the edit does not affect, and the
+ * OutputCapture class, which records the output the checkpoints refer
+ * to.
+ */
+
+#ifndef _history_h
+#define _history_h
+
+#include <climits>
+#include <map>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "evalstate.hpp"
+#include "partial.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: ExecutionHistory
+ * -----------------------
+ * While the tree walker runs a program, the history takes checkpoints
+ * at the starts of basic blocks: the line about to run, the variables
+ * and the length of the output so far.  Checkpoints are numbered by a
+ * clock, and every line the program runs is stamped with the clock
+ * when it first runs.  Lines that a jump or a fall-through names are
+ * stamped separately, since a loop names the line after it on its
+ * first pass but only runs it when it ends.
+ *
+ * Replacing or deleting a line changes what the program does from the
+ * first time it ran that line.  Entering a line changes it from the
+ * first time a jump named it, or the line before it fell through to
+ * the line after it.  Checkpoints taken before that are still
+ * valid.  The variables are stamped in the same way, with the time a
+ * variable is first assigned and the time it is first read while it
+ * has not been assigned yet.  Up to a checkpoint, the program only
+ * depends on the variables it read before assigning them, so a RUN in
+ * which those hold what they held when the recorded RUN started can
+ * resume from there: it prints the recorded output, takes the values
+ * of the variables assigned so far from the checkpoint, and leaves the
+ * other variables alone.
+ *
+ * Input cannot be replayed, so recording stops in front of the first
+ * INPUT, and it also stops once the output reaches MAX_OUTPUT.  The
+ * checkpoints are thinned out whenever there are MAX_CHECKPOINTS of
+ * them, doubling the distance between them, so a long RUN keeps a
+ * bounded number spread over its whole length.
+ */
+
+class ExecutionHistory {
+
+public:
+
+/*
+ * Method: resume
+ * Usage: if (history.resume(plan, state, step)) . . .
+ * ---------------------------------------------------
+ * Looks for the last checkpoint that survived the edits since the
+ * recorded RUN and that state allows resuming from.  If there is one,
+ * restores its variables, writes the output recorded up to it to
+ * std::cout, sets step to the step of plan to continue from and
+ * returns true.  The history then records the rest of this RUN.
+ * Otherwise it returns false and changes nothing.
+ */
+
+    bool resume(const ExecutionPlan &plan, EvalState &state, int &step);
+
+/*
+ * Method: begin
+ * Usage: history.begin(plan, state);
+ * ----------------------------------
+ * Throws the recorded RUN away and starts recording a RUN of plan from
+ * its first step, with the variables in state.
+ */
+
+    void begin(const ExecutionPlan &plan, EvalState &state);
+
+/*
+ * Method: addPrefix
+ * Usage: history.addPrefix(plan, partial, state);
+ * -----------------------------------------------
+ * Marks the lines the partial evaluation ran as run before the first
+ * checkpoint, since RUN replays them instead of walking them.
+ * What they compute does not depend on any variable.
+ */
+
+    void addPrefix(const ExecutionPlan &plan, const PartialEvaluation &partial,
+                   EvalState &state);
+
+/*
+ * Method: visit
+ * Usage: history.visit(plan, step, state);
+ * ----------------------------------------
+ * Called by the tree walker in front of every step it runs.
+ */
+
+    void visit(const ExecutionPlan &plan, int step, EvalState &state);
+
+/*
+ * Method: enterRegion
+ * Usage: history.enterRegion(plan, firstLine, lastLine, state);
+ * -------------------------------------------------------------
+ * Called before compiled code runs the lines from firstLine to
+ * lastLine, which the walker does not see.  All of them count as run,
+ * and as the order in which they run is not known, the
+ * variables they read count as read before they assign any.
+ */
+
+    void enterRegion(const ExecutionPlan &plan, int firstLine, int lastLine,
+                     EvalState &state);
+
+/*
+ * Method: edit
+ * Usage: history.edit(lineNumber);
+ * --------------------------------
+ * Invalidates the checkpoints an edit of the line affects.
+ */
+
+    void edit(int lineNumber);
+
+/*
+ * Method: clear
+ * Usage: history.clear();
+ * -----------------------
+ * Throws the recorded RUN away.
+ */
+
+    void clear();
+
+/*
+ * Method: write
+ * Usage: history.write(data, count);
+ * ----------------------------------
+ * Records output of the RUN; OutputCapture calls it.
+ */
+
+    void write(const char *data, size_t count);
+
+/*
+ * Constants: MAX_CHECKPOINTS, MAX_OUTPUT, CHECKPOINT_INTERVAL
+ * -----------------------------------------------------------
+ * The number of checkpoints that are kept, the amount of output that
+ * is recorded, and the initial number of steps between checkpoints.
+ * A region counts as CHECKPOINT_INTERVAL steps.
+ */
+
+    static const int MAX_CHECKPOINTS = 256;
+    static const size_t MAX_OUTPUT = 1 << 24;
+    static const int CHECKPOINT_INTERVAL = 1000;
+
+private:
+
+/*
+ * Type: Checkpoint
+ * ----------------
+ * The variables in front of a line, and how much had been printed.
+ */
+
+    struct Checkpoint {
+        int time;
+        int lineNumber;
+        size_t output;
+        std::vector<int> values;
+        std::vector<char> defined;
+    };
+
+    void save(Checkpoint &checkpoint, EvalState &state);
+    bool sameAsStart(int slot, EvalState &state) const;
+    void restore(const Checkpoint &checkpoint, EvalState &state);
+    void touch(const ExecutionPlan &plan, int step);
+    void follow(const ExecutionPlan &plan, int lineNumber);
+    void setLines(const ExecutionPlan &plan);
+    void use(Statement *stmt, EvalState &state, bool reads, bool writes);
+    void useExp(Expression *exp, EvalState &state, bool reads, bool writes);
+    void stamp(std::vector<int> &times, int slot);
+
+    bool recording = false;
+    int clock = 0;
+    int horizon = INT_MAX;
+    int since = 0;
+    int interval = CHECKPOINT_INTERVAL;
+    Checkpoint start;
+    std::vector<Checkpoint> checkpoints;
+    std::vector<int> lines;
+    std::vector<int> namedAt;
+    std::vector<int> ranAt;
+    std::map<int, int> missing;
+    std::vector<int> readAt;
+    std::vector<int> writtenAt;
+    std::vector<char> seen;
+    std::string output;
+
+};
+
+/*
+ * Class: OutputCapture
+ * --------------------
+ * While an OutputCapture exists, everything written to std::cout is
+ * also passed to the history, if there is one.
+ */
+
+class OutputCapture : private std::streambuf {
+
+public:
+
+/*
+ * Constructor: OutputCapture
+ * Usage: OutputCapture capture(history);
+ * --------------------------------------
+ * Starts capturing std::cout into history.  A null history captures
+ * nothing and leaves std::cout alone.
+ */
+
+    explicit OutputCapture(ExecutionHistory *history);
+
+/*
+ * Destructor: ~OutputCapture
+ * Usage: usually implicit
+ * -----------------------
+ * Flushes what is buffered and gives std::cout its buffer back.
+ */
+
+    ~OutputCapture();
+
+    OutputCapture(const OutputCapture &) = delete;
+    OutputCapture &operator=(const OutputCapture &) = delete;
+
+private:
+
+    int overflow(int c) override;
+    int sync() override;
+    void drain();
+
+    static const int BUFFER_SIZE = 4096;
+
+    ExecutionHistory *history;
+    std::streambuf *target = nullptr;
+    char buffer[BUFFER_SIZE];
+
+};
+
+#endif
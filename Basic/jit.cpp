@@ -0,0 +1,322 @@
+/*
+ * File: jit.cpp
+ * -------------
+ * This file implements the x86-64 translator declared in jit.h.
+ */
+
+#include "jit.hpp"
+#include "statement.hpp"
+#include "Utils/error.hpp"
+#include <cstring>
+#include <iostream>
+
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+/*
+ * Implementation notes: calling convention
+ * ----------------------------------------
+ * The generated function has the C signature
+ *
+ *     int entry(int *values, char *defined, const void *start);
+ *
+ * and keeps values in rbx and defined in r12 for its whole lifetime.
+ * After the prologue it jumps to start, the native address of the
+ * bytecode instruction to begin with.
+ * The operand stack of the bytecode is the native stack, one 64-bit
+ * push per value.  Its depth at every instruction is known statically,
+ * which is how calls to the C++ helpers keep rsp 16-byte aligned.  The
+ * function returns 0 at END, STATUS_UNDEFINED or STATUS_DIVIDE for the
+ * inline checks, 1 + index for an OP_ERROR message and STATUS_EXIT -
+ * index for an OP_EXIT.
+ */
+
+namespace {
+
+typedef int (*JitEntry)(int *values, char *defined, const void *start);
+
+const int STATUS_UNDEFINED = -1;
+const int STATUS_DIVIDE = -2;
+const int STATUS_EXIT = -3;
+
+void jitPrint(int value) {
+    std::cout << value << std::endl;
+}
+
+int jitInput() {
+    return InputStmt::readValue();
+}
+
+int jitClosed(const ClosedLoop *loop, int *values, char *defined) {
+    return loop->run(values, defined) ? 1 : 0;
+}
+
+/*
+ * Class: Assembler
+ * ----------------
+ * A byte buffer with the handful of encodings the translator needs.
+ * Forward jumps are emitted with a zero displacement and patched.
+ */
+
+class Assembler {
+
+public:
+
+    std::vector<unsigned char> bytes;
+
+    int size() const {
+        return bytes.size();
+    }
+
+    void byte(int b) {
+        bytes.push_back((unsigned char) b);
+    }
+
+    void bytes2(int b1, int b2) {
+        byte(b1);
+        byte(b2);
+    }
+
+    void int32(int value) {
+        unsigned u = (unsigned) value;
+        for (int i = 0; i < 4; i++) byte((u >> (8 * i)) & 0xFF);
+    }
+
+    void int64(unsigned long long value) {
+        for (int i = 0; i < 8; i++) byte((value >> (8 * i)) & 0xFF);
+    }
+
+    void patch32(int at, int value) {
+        unsigned u = (unsigned) value;
+        for (int i = 0; i < 4; i++) bytes[at + i] = (u >> (8 * i)) & 0xFF;
+    }
+
+    /* Emits a rel32 jump (jmp or jcc) and returns the offset of its displacement. */
+    int jump(int opcode) {
+        if (opcode == 0xE9) {
+            byte(0xE9);
+        } else {
+            bytes2(0x0F, opcode);
+        }
+        int at = size();
+        int32(0);
+        return at;
+    }
+
+    void bindJump(int at, int target) {
+        patch32(at, target - (at + 4));
+    }
+
+    void call(void *fn, int depth) {
+        bool pad = depth % 2 != 0;
+        if (pad) { byte(0x48); bytes2(0x83, 0xEC); byte(8); }  // sub rsp, 8
+        bytes2(0x48, 0xB8);                                   // mov rax, imm64
+        int64((unsigned long long) fn);
+        bytes2(0xFF, 0xD0);                                   // call rax
+        if (pad) { byte(0x48); bytes2(0x83, 0xC4); byte(8); }  // add rsp, 8
+    }
+
+    void storeSlot(int slot) {
+        bytes2(0x89, 0x83);                                   // mov [rbx + 4*slot], eax
+        int32(slot * 4);
+        bytes2(0x41, 0xC6); bytes2(0x84, 0x24);               // mov byte [r12 + slot], 1
+        int32(slot);
+        byte(1);
+    }
+
+};
+
+}
+
+JitProgram::JitProgram(const BytecodeProgram &code) : code(code) {
+#if JIT_SUPPORTED
+    translate();
+#endif
+}
+
+JitProgram::~JitProgram() {
+#if JIT_SUPPORTED
+    if (buffer != nullptr) munmap(buffer, capacity);
+#endif
+}
+
+bool JitProgram::isReady() const {
+    return buffer != nullptr;
+}
+
+/*
+ * Implementation notes: translate
+ * -------------------------------
+ * Each bytecode instruction expands to a fixed template.  Jumps are
+ * recorded against bytecode indices and bound once every instruction
+ * has a native address.  The machine code is assembled into a vector,
+ * copied into an anonymous mapping and then made read-only executable.
+ */
+
+void JitProgram::translate() {
+#if JIT_SUPPORTED
+    const std::vector<Instruction> &ins = code.getCode();
+    Assembler a;
+    address.assign(ins.size(), 0);
+    std::vector<std::pair<int, int>> jumps;
+    std::vector<int> undefinedExits, divideExits, endExits;
+
+    a.byte(0x55);                                             // push rbp
+    a.byte(0x48); a.bytes2(0x89, 0xE5);                       // mov rbp, rsp
+    a.byte(0x53);                                             // push rbx
+    a.bytes2(0x41, 0x54);                                     // push r12
+    a.bytes2(0x41, 0x55);                                     // push r13
+    a.bytes2(0x41, 0x56);                                     // push r14
+    a.byte(0x48); a.bytes2(0x89, 0xFB);                       // mov rbx, rdi
+    a.byte(0x49); a.bytes2(0x89, 0xF4);                       // mov r12, rsi
+    a.bytes2(0xFF, 0xE2);                                     // jmp rdx
+
+    int depth = 0;
+    for (size_t i = 0; i < ins.size(); i++) {
+        address[i] = a.size();
+        int operand = ins[i].operand;
+        switch (ins[i].op) {
+            case OP_CONST:
+                a.byte(0x68);                                 // push imm32
+                a.int32(operand);
+                break;
+            case OP_LOAD:
+                a.bytes2(0x41, 0x80); a.bytes2(0xBC, 0x24);   // cmp byte [r12 + slot], 0
+                a.int32(operand);
+                a.byte(0);
+                undefinedExits.push_back(a.jump(0x84));       // je undefined
+                a.bytes2(0x8B, 0x83);                         // mov eax, [rbx + 4*slot]
+                a.int32(operand * 4);
+                a.byte(0x50);                                 // push rax
+                break;
+            case OP_FETCH:
+                a.bytes2(0x8B, 0x83);                         // mov eax, [rbx + 4*slot]
+                a.int32(operand * 4);
+                a.byte(0x50);                                 // push rax
+                break;
+            case OP_DEFINED:
+                a.bytes2(0x41, 0x0F); a.bytes2(0xB6, 0x84);   // movzx eax, byte [r12 + slot]
+                a.byte(0x24);
+                a.int32(operand);
+                a.byte(0x50);                                 // push rax
+                break;
+            case OP_CLOSED:
+                a.bytes2(0x48, 0xBF);                         // mov rdi, imm64
+                a.int64((unsigned long long) &code.getClosedLoop(operand));
+                a.byte(0x48); a.bytes2(0x89, 0xDE);           // mov rsi, rbx
+                a.byte(0x4C); a.bytes2(0x89, 0xE2);           // mov rdx, r12
+                a.call((void *) jitClosed, depth);
+                a.byte(0x50);                                 // push rax
+                break;
+            case OP_STORE:
+                a.byte(0x58);                                 // pop rax
+                a.storeSlot(operand);
+                break;
+            case OP_ASSIGN:
+                a.byte(0x48); a.bytes2(0x8B, 0x04); a.byte(0x24);  // mov rax, [rsp]
+                a.storeSlot(operand);
+                break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_QUOT:
+                a.byte(0x59);                                 // pop rcx
+                a.byte(0x58);                                 // pop rax
+                if (ins[i].op == OP_ADD) {
+                    a.bytes2(0x01, 0xC8);                     // add eax, ecx
+                } else if (ins[i].op == OP_SUB) {
+                    a.bytes2(0x29, 0xC8);                     // sub eax, ecx
+                } else if (ins[i].op == OP_MUL) {
+                    a.byte(0x0F); a.bytes2(0xAF, 0xC1);       // imul eax, ecx
+                } else {
+                    if (ins[i].op == OP_DIV) {
+                        a.bytes2(0x85, 0xC9);                 // test ecx, ecx
+                        divideExits.push_back(a.jump(0x84));  // je divide
+                    }
+                    a.byte(0x99);                             // cdq
+                    a.bytes2(0xF7, 0xF9);                     // idiv ecx
+                }
+                a.byte(0x50);                                 // push rax
+                break;
+            case OP_JUMP:
+                jumps.emplace_back(a.jump(0xE9), operand);
+                break;
+            case OP_JUMP_EQ: case OP_JUMP_LT: case OP_JUMP_GT:
+                a.byte(0x59);                                 // pop rcx
+                a.byte(0x58);                                 // pop rax
+                a.bytes2(0x39, 0xC8);                         // cmp eax, ecx
+                jumps.emplace_back(a.jump(ins[i].op == OP_JUMP_EQ ? 0x84
+                                          : ins[i].op == OP_JUMP_LT ? 0x8C : 0x8F),
+                                   operand);                  // je / jl / jg
+                break;
+            case OP_PRINT:
+                a.byte(0x5F);                                 // pop rdi
+                a.call((void *) jitPrint, depth - 1);
+                break;
+            case OP_INPUT:
+                a.call((void *) jitInput, depth);
+                a.storeSlot(operand);
+                break;
+            case OP_END:
+                a.bytes2(0x31, 0xC0);                         // xor eax, eax
+                endExits.push_back(a.jump(0xE9));
+                break;
+            case OP_EXIT:
+                a.byte(0xB8);                                 // mov eax, STATUS_EXIT - index
+                a.int32(STATUS_EXIT - operand);
+                endExits.push_back(a.jump(0xE9));
+                break;
+            case OP_ERROR:
+                a.byte(0xB8);                                 // mov eax, 1 + index
+                a.int32(operand + 1);
+                endExits.push_back(a.jump(0xE9));
+                break;
+        }
+        depth += stackEffect(ins[i].op);
+    }
+
+    int undefined = a.size();
+    a.byte(0xB8);
+    a.int32(STATUS_UNDEFINED);
+    endExits.push_back(a.jump(0xE9));
+    int divide = a.size();
+    a.byte(0xB8);
+    a.int32(STATUS_DIVIDE);
+    endExits.push_back(a.jump(0xE9));
+
+    int epilogue = a.size();
+    a.byte(0x48); a.bytes2(0x8D, 0x65); a.byte(0xE0);         // lea rsp, [rbp - 32]
+    a.bytes2(0x41, 0x5E);                                     // pop r14
+    a.bytes2(0x41, 0x5D);                                     // pop r13
+    a.bytes2(0x41, 0x5C);                                     // pop r12
+    a.byte(0x5B);                                             // pop rbx
+    a.byte(0x5D);                                             // pop rbp
+    a.byte(0xC3);                                             // ret
+
+    for (auto &jump : jumps) a.bindJump(jump.first, address[jump.second]);
+    for (int at : undefinedExits) a.bindJump(at, undefined);
+    for (int at : divideExits) a.bindJump(at, divide);
+    for (int at : endExits) a.bindJump(at, epilogue);
+
+    capacity = a.bytes.size();
+    void *memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return;
+    std::memcpy(memory, a.bytes.data(), capacity);
+    if (mprotect(memory, capacity, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, capacity);
+        return;
+    }
+    buffer = (unsigned char *) memory;
+#endif
+}
+
+int JitProgram::run(EvalState &state, int start) {
+    JitEntry entry = (JitEntry) (void *) buffer;
+    state.touchAllSlots();
+    int status = entry(state.getValueArray(), state.getDefinedArray(),
+                       buffer + address[start]);
+    if (status == STATUS_UNDEFINED) error("VARIABLE NOT DEFINED");
+    if (status == STATUS_DIVIDE) error("DIVIDE BY ZERO");
+    if (status > 0) error(code.getMessage(status - 1));
+    if (status <= STATUS_EXIT) return code.getExitLine(STATUS_EXIT - status);
+    return END_OF_PLAN;
+}
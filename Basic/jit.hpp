@@ -0,0 +1,95 @@
+/*
+ * File: jit.h
+ * -----------
+ * This interface exports the JitProgram class, which translates the
+ * bytecode of a program into x86-64 machine code and runs it in
+ * process.  RUN uses it when the interpreter is started with --jit on
+ * a host that supports it, and the bytecode VM otherwise.
+ */
+
+#ifndef _jit_h
+#define _jit_h
+
+#include <cstddef>
+#include <vector>
+#include "bytecode.hpp"
+#include "evalstate.hpp"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+/*
+ * Class: JitProgram
+ * -----------------
+ * This class owns the executable buffer holding the native code for
+ * one BytecodeProgram.  Variables stay in the EvalState slot arrays,
+ * arithmetic becomes native add, sub, imul and idiv with an inline
+ * zero-divisor check, and PRINT, INPUT and closed loops call back
+ * into C++.
+ */
+
+class JitProgram {
+
+public:
+
+/*
+ * Constructor: JitProgram
+ * Usage: JitProgram jit(code);
+ * ----------------------------
+ * Translates the bytecode into machine code.  If the host is not
+ * supported or executable memory cannot be obtained, isReady returns
+ * false and the caller should run the bytecode instead.
+ */
+
+    explicit JitProgram(const BytecodeProgram &code);
+
+/*
+ * Destructor: ~JitProgram
+ * Usage: usually implicit
+ * -----------------------
+ * Releases the executable buffer.
+ */
+
+    ~JitProgram();
+
+    JitProgram(const JitProgram &) = delete;
+    JitProgram &operator=(const JitProgram &) = delete;
+
+/*
+ * Method: isReady
+ * Usage: if (jit.isReady()) . . .
+ * -------------------------------
+ * Returns true if native code was generated.
+ */
+
+    bool isReady() const;
+
+/*
+ * Method: run
+ * Usage: jit.run(state);
+ *        int line = jit.run(state, code.getEntry(step));
+ * ------------------------------------------------------
+ * Runs the native code against the slots of state, from the first
+ * instruction or from the given one, and returns what
+ * BytecodeProgram::run would.  A runtime error makes the native code
+ * return a status, which is turned back into the same error() call
+ * the bytecode VM would make.
+ */
+
+    int run(EvalState &state, int start = 0);
+
+private:
+
+    void translate();
+
+    const BytecodeProgram &code;
+    unsigned char *buffer = nullptr;
+    size_t capacity = 0;
+    std::vector<int> address;
+
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * File: loopdetect.cpp
+ * --------------------
+ * This file implements the LoopDetector class.
+ */
+
+#include "loopdetect.hpp"
+#include "Utils/error.hpp"
+#include <cstring>
+
+bool LoopDetector::canWatch(const ExecutionPlan &plan) {
+    for (int i = 0; i < plan.size(); i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt != nullptr && stmt->getType() == INPUT) return false;
+    }
+    return true;
+}
+
+void LoopDetector::check(const void *engine, int position, EvalState &state) {
+    if (engine == savedEngine && position == savedPosition && matches(state)) {
+        error("INFINITE LOOP");
+    }
+    if (++length == power) {
+        savedEngine = engine;
+        savedPosition = position;
+        int slots = state.getSlotCount();
+        values.assign(state.getValueArray(), state.getValueArray() + slots);
+        defined.assign(state.getDefinedArray(), state.getDefinedArray() + slots);
+        power *= 2;
+        length = 0;
+    }
+}
+
+/*
+ * Implementation notes: matches
+ * -----------------------------
+ * Slots allocated since the save are new variables, which must still
+ * be undefined.  The values of undefined slots are compared as well,
+ * which can only miss a loop, never invent one.
+ */
+
+bool LoopDetector::matches(EvalState &state) const {
+    int saved = values.size();
+    for (int slot = saved; slot < state.getSlotCount(); slot++) {
+        if (state.isSlotDefined(slot)) return false;
+    }
+    return std::memcmp(values.data(), state.getValueArray(), saved * sizeof(int)) == 0
+           && std::memcmp(defined.data(), state.getDefinedArray(), saved) == 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * File: loopdetect.h
+ * ------------------
+ * This interface exports the LoopDetector class, which stops a RUN as
+ * soon as the program is provably stuck in an infinite loop.
+ */
+
+#ifndef _loopdetect_h
+#define _loopdetect_h
+
+#include <vector>
+#include "evalstate.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: LoopDetector
+ * -------------------
+ * A program without INPUT is deterministic, so if it reaches the same
+ * backward jump twice with exactly the same variables, it repeats the
+ * stretch in between forever.  The engines call check at every
+ * backward jump, and the detector compares that point with one saved
+ * point, as in Brent's cycle-finding algorithm: the saved point moves
+ * to the current one after 1, 2, 4, ... checks.  A loop of n backward
+ * jumps entered after m of them is found within about 2 (m + n)
+ * checks.
+ *
+ * Comparing is cheap in the common case: the position is compared
+ * first, and the variables only when the program is back at the saved
+ * jump.  The detector never reports a loop that is not one, because
+ * the variables are compared in full rather than by a hash.
+ */
+
+class LoopDetector {
+
+public:
+
+/*
+ * Method: canWatch
+ * Usage: if (LoopDetector::canWatch(plan)) . . .
+ * ----------------------------------------------
+ * Returns true if plan has no INPUT, so that a repeated state means
+ * the program never ends.
+ */
+
+    static bool canWatch(const ExecutionPlan &plan);
+
+/*
+ * Method: check
+ * Usage: detector.check(engine, position, state);
+ * -----------------------------------------------
+ * Called at a backward jump, identified by the engine running it and
+ * its position there.  Raises INFINITE LOOP with error() if the
+ * program has been at the same jump with the same variables before.
+ */
+
+    void check(const void *engine, int position, EvalState &state);
+
+private:
+
+    bool matches(EvalState &state) const;
+
+    const void *savedEngine = nullptr;
+    int savedPosition = -1;
+    std::vector<int> values;
+    std::vector<char> defined;
+    long long power = 1;
+    long long length = 0;
+
+};
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * File: loopopt.cpp
+ * -----------------
+ * This file implements the LoopOptimizer class.
+ */
+
+#include "loopopt.hpp"
+#include "cfg.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace {
+
+/*
+ * Class: LoopScan
+ * ---------------
+ * The facts gathered from the statements of one loop: how often each
+ * variable is assigned, the LET statement that assigns it when that
+ * is its only assignment, and the step of each induction variable.
+ */
+
+class LoopScan {
+
+public:
+
+    LoopScan(const ExecutionPlan &plan, int header, int latch, Loop &loop);
+
+private:
+
+    void countStores(Expression *exp);
+    void visit(Expression *exp);
+    bool isInvariant(Expression *exp);
+    bool isInvariantFactor(Expression *exp);
+    bool isInduction(Expression *exp);
+    void hoist(Expression *exp);
+    void addGuards(Expression *exp);
+    void addGuard(std::vector<std::string> &guards, std::set<std::string> &seen,
+                  const std::string &var);
+    void reduce();
+    std::string tempName();
+
+    const ExecutionPlan &plan;
+    Loop &loop;
+    std::map<std::string, int> stores;
+    std::map<std::string, LetStmt *> onlyStore;
+    std::map<std::string, int> steps;
+    std::map<std::string, int> hoisted;
+    std::map<std::string, std::vector<Expression *>> products;
+    std::set<std::string> definedSeen, divisorSeen;
+    int temps = 0;
+
+};
+
+std::string variableOf(Expression *exp) {
+    return ((IdentifierExp *) exp)->getName();
+}
+
+LoopScan::LoopScan(const ExecutionPlan &plan, int header, int latch, Loop &loop)
+        : plan(plan), loop(loop) {
+    std::vector<Expression *> roots;
+    for (int i = header; i <= latch; i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET: {
+                LetStmt *let = (LetStmt *) stmt;
+                if (stores[let->getVar()]++ == 0) onlyStore[let->getVar()] = let;
+                roots.push_back(let->getExp());
+                break;
+            }
+            case PRINT:
+                roots.push_back(((PrintStmt *) stmt)->getExp());
+                break;
+            case INPUT:
+                stores[((InputStmt *) stmt)->getVar()] += 2;
+                break;
+            case IF:
+                roots.push_back(((IfStmt *) stmt)->getLHS());
+                roots.push_back(((IfStmt *) stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    for (Expression *root : roots) countStores(root);
+    for (auto &entry : onlyStore) {
+        if (stores[entry.first] != 1) continue;
+        Expression *exp = entry.second->getExp();
+        if (exp->getType() != COMPOUND) continue;
+        CompoundExp *sum = (CompoundExp *) exp;
+        std::string op = sum->getOp();
+        if ((op == "+" || op == "-") && sum->getLHS()->getType() == IDENTIFIER
+            && variableOf(sum->getLHS()) == entry.first && sum->getRHS()->getType() == CONSTANT) {
+            int c = ((ConstantExp *) sum->getRHS())->getValue();
+            steps[entry.first] = op == "+" ? c : (int) (0u - (unsigned) c);
+        }
+    }
+    for (Expression *root : roots) visit(root);
+    reduce();
+}
+
+/*
+ * Implementation notes: countStores
+ * ---------------------------------
+ * Assignments nested in expressions count like LET statements, but are
+ * never the single store of an induction variable.
+ */
+
+void LoopScan::countStores(Expression *exp) {
+    if (exp->getType() != COMPOUND) return;
+    CompoundExp *compound = (CompoundExp *) exp;
+    if (compound->getOp() == "=" && compound->getLHS()->getType() == IDENTIFIER) {
+        stores[variableOf(compound->getLHS())] += 2;
+    }
+    countStores(compound->getLHS());
+    countStores(compound->getRHS());
+}
+
+/*
+ * Implementation notes: visit
+ * ---------------------------
+ * Walks an expression top-down and hoists the largest invariant
+ * subexpressions; a single variable or constant is not worth a hidden
+ * variable.  The left side of an assignment is a target, not a value.
+ */
+
+void LoopScan::visit(Expression *exp) {
+    if (exp->getType() != COMPOUND) return;
+    CompoundExp *compound = (CompoundExp *) exp;
+    std::string op = compound->getOp();
+    if (op == "=") {
+        visit(compound->getRHS());
+        return;
+    }
+    if (isInvariant(exp)) {
+        hoist(exp);
+        return;
+    }
+    Expression *lhs = compound->getLHS(), *rhs = compound->getRHS();
+    if (op == "*" && ((isInduction(lhs) && isInvariantFactor(rhs))
+                      || (isInduction(rhs) && isInvariantFactor(lhs)))) {
+        products[exp->toString()].push_back(exp);
+        return;
+    }
+    visit(lhs);
+    visit(rhs);
+}
+
+bool LoopScan::isInvariant(Expression *exp) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return true;
+        case IDENTIFIER:
+            return stores.count(variableOf(exp)) == 0;
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            if (op == "=") return false;
+            Expression *rhs = compound->getRHS();
+            if (op == "/") {
+                if (rhs->getType() == CONSTANT) {
+                    int divisor = ((ConstantExp *) rhs)->getValue();
+                    if (divisor == 0 || divisor == -1) return false;
+                } else if (rhs->getType() != IDENTIFIER) {
+                    return false;
+                }
+            }
+            return isInvariant(compound->getLHS()) && isInvariant(rhs);
+        }
+    }
+}
+
+bool LoopScan::isInvariantFactor(Expression *exp) {
+    return exp->getType() == CONSTANT
+           || (exp->getType() == IDENTIFIER && stores.count(variableOf(exp)) == 0);
+}
+
+bool LoopScan::isInduction(Expression *exp) {
+    return exp->getType() == IDENTIFIER && steps.count(variableOf(exp)) > 0;
+}
+
+void LoopScan::hoist(Expression *exp) {
+    if (exp->getType() != COMPOUND) return;
+    std::string key = exp->toString();
+    auto it = hoisted.find(key);
+    if (it != hoisted.end()) {
+        loop.uses[exp] = it->second;
+        return;
+    }
+    HoistedValue value;
+    value.exp = exp;
+    value.temp = tempName();
+    int index = loop.values.size();
+    loop.values.push_back(value);
+    hoisted[key] = index;
+    loop.uses[exp] = index;
+    addGuards(exp);
+}
+
+void LoopScan::addGuards(Expression *exp) {
+    if (exp->getType() == IDENTIFIER) {
+        addGuard(loop.definedGuards, definedSeen, variableOf(exp));
+    } else if (exp->getType() == COMPOUND) {
+        CompoundExp *compound = (CompoundExp *) exp;
+        if (compound->getOp() == "/" && compound->getRHS()->getType() == IDENTIFIER) {
+            addGuard(loop.divisorGuards, divisorSeen, variableOf(compound->getRHS()));
+        }
+        addGuards(compound->getLHS());
+        addGuards(compound->getRHS());
+    }
+}
+
+void LoopScan::addGuard(std::vector<std::string> &guards, std::set<std::string> &seen,
+                        const std::string &var) {
+    if (seen.insert(var).second) guards.push_back(var);
+}
+
+/*
+ * Implementation notes: reduce
+ * ----------------------------
+ * Replacing a product saves two instructions per use, and keeping its
+ * hidden variable up to date costs four per change of the induction
+ * variable, two of them loads, which are dearer than the constant
+ * pushes they replace; so only products used REDUCTION_USES times are
+ * reduced.
+ * Wrapping arithmetic keeps temp equal to V * K exactly.
+ */
+
+void LoopScan::reduce() {
+    for (auto &entry : products) {
+        if ((int) entry.second.size() < LoopOptimizer::REDUCTION_USES) continue;
+        CompoundExp *product = (CompoundExp *) entry.second[0];
+        bool inductionLeft = isInduction(product->getLHS());
+        Expression *induction = inductionLeft ? product->getLHS() : product->getRHS();
+        Expression *factor = inductionLeft ? product->getRHS() : product->getLHS();
+        std::string var = variableOf(induction);
+        HoistedValue value;
+        value.exp = product;
+        value.temp = tempName();
+        value.reduced = true;
+        value.factor = factor;
+        value.step = steps[var];
+        if (factor->getType() == CONSTANT) {
+            int k = ((ConstantExp *) factor)->getValue();
+            value.stepValue = (int) ((unsigned) value.step * (unsigned) k);
+        } else {
+            value.stepTemp = tempName();
+        }
+        int index = loop.values.size();
+        loop.values.push_back(value);
+        for (Expression *use : entry.second) loop.uses[use] = index;
+        loop.updates[onlyStore[var]].push_back(index);
+        addGuards(product);
+    }
+}
+
+/*
+ * Implementation notes: tempName
+ * ------------------------------
+ * Hidden variables are named after the header line, so a program that
+ * is run again reuses its slots.  No BASIC identifier contains '#'.
+ */
+
+std::string LoopScan::tempName() {
+    return "#" + std::to_string(plan.getStep(loop.header).lineNumber) + "." + std::to_string(temps++);
+}
+
+}
+
+/*
+ * Implementation notes: LoopOptimizer constructor
+ * -----------------------------------------------
+ * The loops come from the ControlFlowGraph of the plan.  The steps
+ * from the header to the last latch form the loop [header, latch];
+ * a latch placed before its header does not close a loop here.  A
+ * loop is only taken when it is innermost, that is, when no other
+ * backward jump starts or ends inside the steps, and when no jump from
+ * outside them can enter it other than at its header.
+ */
+
+LoopOptimizer::LoopOptimizer(const ExecutionPlan &plan) {
+    const ControlFlowGraph &cfg = plan.getControlFlowGraph();
+    for (const CFGLoop &cfgLoop : cfg.getLoops()) {
+        int header = plan.getBlock(cfgLoop.header).first, latch = -1;
+        for (int block : cfgLoop.latches) {
+            int last = plan.getBlock(block).last;
+            if (last >= header) latch = std::max(latch, last);
+        }
+        if (latch != -1 && isInnermost(plan, header, latch)
+            && isSingleEntry(plan, cfg, header, latch)) {
+            analyze(plan, header, latch);
+        }
+    }
+}
+
+bool LoopOptimizer::isInnermost(const ExecutionPlan &plan, int header, int latch) const {
+    for (int i = header; i <= latch; i++) {
+        const PlanStep &step = plan.getStep(i);
+        if (step.stmt == nullptr || step.badTarget || step.target == END_OF_PLAN) continue;
+        StatementType type = step.stmt->getType();
+        if ((type == GOTO || type == IF) && step.target <= i && step.target != header) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LoopOptimizer::isSingleEntry(const ExecutionPlan &plan, const ControlFlowGraph &cfg,
+                                  int header, int latch) const {
+    for (int block = plan.getBlockOf(header) + 1;
+         block < plan.getBlockCount() && plan.getBlock(block).first <= latch; block++) {
+        for (int i = 0; i < cfg.getPredecessorCount(block); i++) {
+            int last = plan.getBlock(cfg.getPredecessor(block, i)).last;
+            if (last < header || last > latch) return false;
+        }
+    }
+    return true;
+}
+
+void LoopOptimizer::analyze(const ExecutionPlan &plan, int header, int latch) {
+    Loop loop;
+    loop.header = header;
+    loop.latch = latch;
+    LoopScan scan(plan, header, latch, loop);
+    if (!loop.values.empty()) loops.emplace(header, std::move(loop));
+}
+
+const Loop *LoopOptimizer::findLoop(int header) const {
+    auto it = loops.find(header);
+    return it == loops.end() ? nullptr : &it->second;
+}
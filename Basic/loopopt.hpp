@@ -0,0 +1,129 @@
+/*
+ * File: loopopt.h
+ * ---------------
+ * This interface exports the LoopOptimizer class, which finds the
+ * innermost loops of an ExecutionPlan and decides which computations
+ * the bytecode compiler can move out of them.
+ */
+
+#ifndef _loopopt_h
+#define _loopopt_h
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "exp.hpp"
+#include "plan.hpp"
+
+class ControlFlowGraph;
+
+/*
+ * Type: HoistedValue
+ * ------------------
+ * A value kept in a hidden variable (temp) while a loop runs.  For a
+ * loop-invariant expression, exp is computed once before the loop.
+ * For a product of an induction variable and a loop-invariant factor
+ * (strength reduction), exp is computed before the loop as well, and
+ * every time the induction variable changes by step, temp changes by
+ * step * factor: the constant stepValue, or the hidden variable
+ * stepTemp when factor is a variable.
+ */
+
+struct HoistedValue {
+    Expression *exp;
+    std::string temp;
+    bool reduced = false;
+    Expression *factor = nullptr;
+    int step = 0;
+    int stepValue = 0;
+    std::string stepTemp;
+};
+
+/*
+ * Type: Loop
+ * ----------
+ * A single-entry loop made of the steps [header, latch].  uses maps the
+ * expression nodes inside the loop to the index of the value in values
+ * that replaces them, and updates maps the LET statement of each
+ * induction variable to the reduced values it must advance.
+ *
+ * The hoisted values may only be computed when evaluating them cannot
+ * fail: every variable in definedGuards must be defined and no
+ * variable in divisorGuards may be 0 or -1.  Since a variable stays
+ * defined once set and none of these variables is assigned inside the
+ * loop, the guards checked on entry hold for every iteration.
+ */
+
+struct Loop {
+    int header;
+    int latch;
+    std::vector<HoistedValue> values;
+    std::unordered_map<Expression *, int> uses;
+    std::unordered_map<Statement *, std::vector<int>> updates;
+    std::vector<std::string> definedGuards;
+    std::vector<std::string> divisorGuards;
+};
+
+/*
+ * Class: LoopOptimizer
+ * --------------------
+ * Finds the loops of a plan, their invariant expressions and their
+ * induction variables.  A loop is recognized when a GOTO or IF jumps
+ * back to an earlier step, the steps in between contain no other loop,
+ * and no jump from outside lands strictly inside them.
+ *
+ * An expression is invariant if it reads only variables that no
+ * statement of the loop assigns, performs no assignment, and divides
+ * only by a constant or a guarded variable.  An induction variable is
+ * assigned exactly once in the loop, by LET V = V + c or LET V = V - c.
+ * A product V * K of an induction variable and an invariant factor is
+ * only reduced when it is used often enough to pay for the update.
+ */
+
+class LoopOptimizer {
+
+public:
+
+/*
+ * Constructor: LoopOptimizer
+ * Usage: LoopOptimizer loops(plan);
+ * ---------------------------------
+ * Analyzes the loops of plan.  The results refer to the statements
+ * of the plan and are valid as long as the plan is.
+ */
+
+    explicit LoopOptimizer(const ExecutionPlan &plan);
+
+/*
+ * Method: findLoop
+ * Usage: const Loop *loop = loops.findLoop(step);
+ * -----------------------------------------------
+ * Returns the optimized loop whose header is the given step, or
+ * nullptr if there is none.
+ */
+
+    const Loop *findLoop(int header) const;
+
+/*
+ * Constant: REDUCTION_USES
+ * ------------------------
+ * The number of uses of the same product inside a loop from which
+ * strength reduction pays for updating its hidden variable.  In the
+ * bytecode VM a multiplication is no dearer than an addition, so the
+ * gain is only in the instructions saved.
+ */
+
+    static const int REDUCTION_USES = 4;
+
+private:
+
+    bool isInnermost(const ExecutionPlan &plan, int header, int latch) const;
+    bool isSingleEntry(const ExecutionPlan &plan, const ControlFlowGraph &cfg, int header,
+                       int latch) const;
+    void analyze(const ExecutionPlan &plan, int header, int latch);
+
+    std::unordered_map<int, Loop> loops;
+
+};
+
+#endif
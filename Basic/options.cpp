@@ -0,0 +1,65 @@
+/*
+ * File: options.cpp
+ * -----------------
+ * This file implements the command-line options declared in options.h.
+ */
+
+#include "options.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+Options options;
+
+void parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--tree") {
+            options.treeWalk = true;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--no-trace") {
+            options.traces = false;
+        } else if (arg == "--no-constprop") {
+            options.constantPropagation = false;
+        } else if (arg == "--no-loop-opt") {
+            options.loopOptimization = false;
+        } else if (arg == "--no-dce") {
+            options.deadCodeElimination = false;
+        } else if (arg == "--no-definite") {
+            options.definiteAssignment = false;
+        } else if (arg == "--no-ranges") {
+            options.valueRanges = false;
+        } else if (arg == "--no-closed-form") {
+            options.closedForms = false;
+        } else if (arg == "--no-partial-eval") {
+            options.partialEvaluation = false;
+        } else if (arg == "--no-tiering") {
+            options.tiering = false;
+        } else if (arg == "--no-history") {
+            options.history = false;
+        } else if (arg == "--no-memo") {
+            options.memoization = false;
+        } else if (arg == "--detect-loops") {
+            options.detectLoops = true;
+        } else if (arg == "--report-ranges") {
+            options.reportRanges = true;
+        } else if (arg == "--fusion-stats") {
+            options.fusionStats = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--tree] [--jit] [--no-trace]"
+                      << " [--no-constprop] [--no-loop-opt] [--no-dce]"
+                      << " [--no-definite] [--no-ranges] [--no-closed-form]"
+                      << " [--no-partial-eval] [--no-tiering] [--no-history]"
+                      << " [--no-memo] [--detect-loops] [--report-ranges]"
+                      << " [--fusion-stats]"
+                      << std::endl;
+            exit(1);
+        }
+    }
+    if (options.detectLoops) {
+        options.jit = false;
+        options.traces = false;
+        options.deadCodeElimination = false;
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * File: options.h
+ * ---------------
+ * This interface exports the command-line options of the interpreter.
+ * Every option defaults to the behavior the interpreter has with no
+ * arguments, which is how the test harness runs it.
+ */
+
+#ifndef _options_h
+#define _options_h
+
+/*
+ * Type: Options
+ * -------------
+ * The settings that can be changed from the command line.
+ *
+ *  --tree      RUN walks the Statement trees instead of the bytecode
+ *  --jit       RUN translates the bytecode to native code when it can
+ *  --no-trace  the bytecode VM does not compile traces of hot loops
+ *  --no-constprop  the bytecode compiler does not substitute the
+ *              constants found by ConstantPropagation
+ *  --no-loop-opt  the bytecode compiler does not hoist invariant
+ *              expressions or reduce products in loops (see loopopt.h)
+ *  --no-dce    the bytecode compiler keeps unreachable statements and
+ *              dead stores (see deadcode.h)
+ *  --no-definite  every variable read in the bytecode checks that the
+ *              variable is defined (see definite.h)
+ *  --no-ranges  every division in the bytecode checks its divisor for
+ *              0, even where ValueRanges proves it cannot be (see ranges.h)
+ *  --no-closed-form  counting loops run iteration by iteration instead
+ *              of being computed in closed form (see closedform.h)
+ *  --no-partial-eval  RUN executes the whole program instead of
+ *              replaying what it computed ahead of time (see partial.h)
+ *  --no-tiering  RUN compiles the program to bytecode at once instead
+ *              of starting in the tree walker until a loop gets hot
+ *              (see profile.h)
+ *  --no-history  RUN always starts from the first line instead of
+ *              resuming from a checkpoint of the previous RUN that the
+ *              edits since have left valid (see history.h)
+ *  --no-memo   the tree walker evaluates every subexpression each time
+ *              instead of reusing values whose variables have not
+ *              changed (see compiledexp.h)
+ *  --detect-loops  RUN stops a program without INPUT with INFINITE
+ *              LOOP once it is back at a backward jump with exactly the
+ *              same variables (see loopdetect.h); it implies --no-trace
+ *              and --no-dce and overrides --jit, so that every backward
+ *              jump is taken by the interpreter and every store is made
+ *  --report-ranges  every RUN first writes the findings of ValueRanges
+ *              to std::cerr, to spot operations that may overflow
+ *  --fusion-stats  on exit, the counts of fused statement forms that
+ *              ran are written to std::cerr (see FusedForm)
+ */
+
+struct Options {
+    bool treeWalk = false;
+    bool jit = false;
+    bool traces = true;
+    bool constantPropagation = true;
+    bool loopOptimization = true;
+    bool deadCodeElimination = true;
+    bool definiteAssignment = true;
+    bool valueRanges = true;
+    bool reportRanges = false;
+    bool closedForms = true;
+    bool partialEvaluation = true;
+    bool tiering = true;
+    bool history = true;
+    bool memoization = true;
+    bool detectLoops = false;
+    bool fusionStats = false;
+};
+
+/*
+ * Variable: options
+ * -----------------
+ * The options in effect for this process.
+ */
+
+extern Options options;
+
+/*
+ * Function: parseOptions
+ * Usage: parseOptions(argc, argv);
+ * --------------------------------
+ * Reads the command-line arguments into options.  An unknown argument
+ * prints a usage message and exits.
+ */
+
+void parseOptions(int argc, char **argv);
+
+#endif
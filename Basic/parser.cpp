@@ -5,11 +5,13 @@
  */
 
 #include "parser.hpp"
+#include "fold.hpp"
 
 /*
  * Implementation notes: parseExp
  * ------------------------------
- * This code just reads an expression and then checks for extra tokens.
+ * This code reads an expression, checks for extra tokens and then
+ * simplifies the tree with foldConstants.
  */
 
 Expression *parseExp(TokenScanner &scanner, bool allowAssignment) {
@@ -18,7 +20,7 @@ Expression *parseExp(TokenScanner &scanner, bool allowAssignment) {
         if (scanner.hasMoreTokens()) {
             error("SYNTAX ERROR");
         }
-        return exp;
+        return foldConstants(exp);
     } catch (ErrorException &ex) {
         error("SYNTAX ERROR");
         return nullptr;
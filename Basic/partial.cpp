@@ -0,0 +1,182 @@
+/*
+ * File: partial.cpp
+ * -----------------
+ * This file implements the PartialEvaluation class.
+ */
+
+#include "partial.hpp"
+#include "statement.hpp"
+#include "Utils/error.hpp"
+#include <climits>
+#include <iostream>
+
+/*
+ * Implementation notes: PartialEvaluation constructor
+ * ---------------------------------------------------
+ * Control flow follows ExecutionPlan::run.  Each step either runs to
+ * completion or is undone and becomes the resume step, so the store
+ * always holds the state between two steps.  Runtime errors are raised
+ * with error() as the statements would raise them and end the
+ * evaluation; what the failing step did before the error stays, as it
+ * does when the program runs.
+ */
+
+PartialEvaluation::PartialEvaluation(const ExecutionPlan &plan) {
+    int index = plan.size() == 0 ? END_OF_PLAN : 0;
+    executed.assign(plan.size(), false);
+    while (index != END_OF_PLAN) {
+        const PlanStep &step = plan.getStep(index);
+        undoLog.clear();
+        if (steps >= STEP_BUDGET && step.leader) break;
+        steps++;
+        executed[index] = true;
+        Statement *stmt = step.stmt;
+        if (stmt == nullptr) {
+            index = step.next;
+            continue;
+        }
+        try {
+            if ((stmt->getType() == GOTO || stmt->getType() == IF) && step.badTarget) {
+                error("LINE NUMBER ERROR");
+            }
+            if (stmt->getType() == END) {
+                index = END_OF_PLAN;
+            } else if (stmt->getType() == GOTO) {
+                index = step.target;
+            } else if (stmt->getType() == IF) {
+                IfStmt *ifStmt = (IfStmt *) stmt;
+                int lhs, rhs;
+                if (!eval(ifStmt->getLHS(), lhs) || !eval(ifStmt->getRHS(), rhs)) break;
+                char op = ifStmt->getOp()[0];
+                bool taken = op == '=' ? lhs == rhs : op == '<' ? lhs < rhs : lhs > rhs;
+                index = taken ? step.target : step.next;
+            } else if (!execute(step)) {
+                break;
+            } else {
+                index = step.next;
+            }
+        } catch (ErrorException &ex) {
+            failure = ex.getMessage();
+            index = END_OF_PLAN;
+        }
+    }
+    if (index != END_OF_PLAN) {
+        undo();
+        resume = index;
+    }
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * Runs a step that is not a jump or END and returns false if it has
+ * to be left to the compiled program.
+ */
+
+bool PartialEvaluation::execute(const PlanStep &step) {
+    int value;
+    switch (step.stmt->getType()) {
+        case LET: {
+            LetStmt *let = (LetStmt *) step.stmt;
+            if (!eval(let->getExp(), value)) return false;
+            values[let->getVar()] = value;
+            return true;
+        }
+        case PRINT: {
+            Expression *exp = ((PrintStmt *) step.stmt)->getExp();
+            if (exp == nullptr) return true;
+            if (!eval(exp, value)) return false;
+            output += std::to_string(value) + "\n";
+            return true;
+        }
+        case INPUT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/*
+ * Implementation notes: eval
+ * --------------------------
+ * Mirrors CompoundExp::eval, with wrapping arithmetic.  A nested
+ * assignment logs the value it replaces, so that a step that stops
+ * half way can be undone.
+ */
+
+bool PartialEvaluation::eval(Expression *exp, int &value) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            value = ((ConstantExp *) exp)->getValue();
+            return true;
+        case IDENTIFIER: {
+            auto it = values.find(((IdentifierExp *) exp)->getName());
+            if (it == values.end()) return false;
+            value = it->second;
+            return true;
+        }
+        default:
+            break;
+    }
+    CompoundExp *compound = (CompoundExp *) exp;
+    std::string op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == "=") {
+        if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") error("SYNTAX ERROR");
+        if (!eval(compound->getRHS(), value)) return false;
+        std::string name = ((IdentifierExp *) lhs)->getName();
+        auto it = values.find(name);
+        if (it == values.end()) {
+            undoLog.push_back({name, {false, 0}});
+        } else {
+            undoLog.push_back({name, {true, it->second}});
+        }
+        values[name] = value;
+        return true;
+    }
+    int left, right;
+    if (!eval(lhs, left) || !eval(compound->getRHS(), right)) return false;
+    if (op == "+") {
+        value = (unsigned) left + (unsigned) right;
+    } else if (op == "-") {
+        value = (unsigned) left - (unsigned) right;
+    } else if (op == "*") {
+        value = (unsigned) left * (unsigned) right;
+    } else {
+        if (right == 0) error("DIVIDE BY ZERO");
+        if (left == INT_MIN && right == -1) return false;
+        value = left / right;
+    }
+    return true;
+}
+
+void PartialEvaluation::undo() {
+    for (auto it = undoLog.rbegin(); it != undoLog.rend(); ++it) {
+        if (it->second.first) {
+            values[it->first] = it->second.second;
+        } else {
+            values.erase(it->first);
+        }
+    }
+    undoLog.clear();
+}
+
+bool PartialEvaluation::isComplete() const {
+    return resume == END_OF_PLAN;
+}
+
+int PartialEvaluation::getResumeStep() const {
+    return resume;
+}
+
+bool PartialEvaluation::hasRun(int step) const {
+    return executed[step];
+}
+
+void PartialEvaluation::replay(EvalState &state) const {
+    std::cout << output << std::flush;
+    for (auto &entry : values) {
+        state.setSlotValue(state.getSlot(entry.first), entry.second);
+    }
+    if (!failure.empty()) error(failure);
+}
@@ -0,0 +1,119 @@
+/*
+ * File: partial.h
+ * ---------------
+ * This interface exports the PartialEvaluation class, which runs the
+ * part of a program that does not depend on input or on the variables
+ * left behind by earlier RUNs once, when the program is compiled, so
+ * that later RUNs can replay its effects instead of executing it.
+ */
+
+#ifndef _partial_h
+#define _partial_h
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: PartialEvaluation
+ * ------------------------
+ * The evaluator executes the plan from its first step over a private
+ * store in which every variable starts unknown, recording what the
+ * program prints and the variables it writes.  It stops in front of
+ * the first step it cannot run without knowing more: one that reads a
+ * variable the program has not written yet, an INPUT, or a division
+ * that would crash.  Everything it has done up to there is the same
+ * on every RUN, whatever the EvalState holds.
+ *
+ * A program that reaches END, falls off its last line or raises an
+ * error before stopping is complete, and replaying it is the whole
+ * RUN.  Otherwise RUN replays the prefix and carries on with the
+ * compiled program from the step the evaluator stopped at.  So that
+ * long loops are still left to the compiled code, the evaluator gives
+ * up after STEP_BUDGET steps, at the next start of a basic block.
+ */
+
+class PartialEvaluation {
+
+public:
+
+/*
+ * Constructor: PartialEvaluation
+ * Usage: PartialEvaluation partial(plan);
+ * ---------------------------------------
+ * Evaluates plan as far as it can.  The result is valid as long as
+ * the plan is.
+ */
+
+    explicit PartialEvaluation(const ExecutionPlan &plan);
+
+/*
+ * Method: isComplete
+ * Usage: if (partial.isComplete()) . . .
+ * --------------------------------------
+ * Returns true if the evaluator ran the program to its end.
+ */
+
+    bool isComplete() const;
+
+/*
+ * Method: getResumeStep
+ * Usage: int step = partial.getResumeStep();
+ * ------------------------------------------
+ * Returns the step a RUN has to continue from after replay, which is
+ * END_OF_PLAN for a complete evaluation.
+ */
+
+    int getResumeStep() const;
+
+/*
+ * Method: replay
+ * Usage: partial.replay(state);
+ * -----------------------------
+ * Writes the recorded output to std::cout and stores the recorded
+ * values into state.  If the evaluated part ended with a runtime
+ * error, the error is then raised with error(), just as running the
+ * program would raise it.
+ */
+
+    void replay(EvalState &state) const;
+
+/*
+ * Method: hasRun
+ * Usage: if (partial.hasRun(step)) . . .
+ * --------------------------------------
+ * Returns true if the evaluator began the step, even if it then had
+ * to stop in front of it.
+ */
+
+    bool hasRun(int step) const;
+
+/*
+ * Constant: STEP_BUDGET
+ * ---------------------
+ * The number of steps after which the evaluator looks for a place to
+ * stop.
+ */
+
+    static const int STEP_BUDGET = 100000;
+
+private:
+
+    bool execute(const PlanStep &step);
+    bool eval(Expression *exp, int &value);
+    void undo();
+
+    std::unordered_map<std::string, int> values;
+    std::vector<std::pair<std::string, std::pair<bool, int>>> undoLog;
+    std::string output;
+    std::string failure;
+    std::vector<char> executed;
+    int resume = END_OF_PLAN;
+    int steps = 0;
+
+};
+
+#endif
@@ -0,0 +1,633 @@
+/*
+ * File: plan.cpp
+ * --------------
+ * This file implements the ExecutionPlan class.
+ */
+
+#include "plan.hpp"
+#include "cfg.hpp"
+#include "history.hpp"
+#include "loopdetect.hpp"
+#include "Utils/error.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+/*
+ * Function: jumpLine
+ * Usage: int lineNumber = jumpLine(stmt);
+ * ---------------------------------------
+ * Returns the line a GOTO or IF names, or -1 for other statements.
+ */
+
+int jumpLine(Statement *stmt) {
+    if (stmt == nullptr) return -1;
+    if (stmt->getType() == GOTO) return ((GotoStmt *) stmt)->getLineNumber();
+    if (stmt->getType() == IF) return ((IfStmt *) stmt)->getLineNumber();
+    return -1;
+}
+
+}
+
+/*
+ * Implementation notes: ExecutionPlan constructors
+ * ------------------------------------------------
+ * The line numbers come out of the program in ascending order, so a
+ * binary search over them resolves each jump once.  A jump to line 0
+ * leaves the program, because the line-by-line interpreter implements
+ * GOTO n as setCurrentLine(n - 1) and -1 means END.  A region takes
+ * its lines and statements from the plan of the whole program, which
+ * also tells which lines outside the region exist.
+ */
+
+ExecutionPlan::ExecutionPlan(Program &program) {
+    relink(program);
+}
+
+ExecutionPlan::ExecutionPlan(const ExecutionPlan &plan, int first, int last) {
+    std::vector<int> lineNumbers;
+    std::vector<Statement *> stmts;
+    for (int i = first; i <= last; i++) {
+        lineNumbers.push_back(plan.steps[i].lineNumber);
+        stmts.push_back(plan.steps[i].stmt);
+    }
+    link(lineNumbers, stmts, &plan);
+}
+
+ExecutionPlan::~ExecutionPlan() {
+    delete graph;
+}
+
+void ExecutionPlan::relink(Program &program) {
+    std::vector<int> lineNumbers;
+    std::vector<Statement *> stmts;
+    for (int lineNumber = program.getFirstLineNumber(); lineNumber != -1;
+         lineNumber = program.getNextLineNumber(lineNumber)) {
+        lineNumbers.push_back(lineNumber);
+        stmts.push_back(program.getParsedStatement(lineNumber));
+    }
+    steps.clear();
+    link(lineNumbers, stmts, nullptr);
+    indexJumps();
+}
+
+/*
+ * Implementation notes: link
+ * --------------------------
+ * In a region, a target outside lineNumbers is looked up in the whole
+ * program.  Exit steps are numbered in the order their lines are first
+ * needed and only added once all steps are linked, so that threading
+ * and block building treat them like any other step.  The exit the
+ * last line falls through to is always the first one, because the
+ * backends lay it out right after that line.
+ */
+
+void ExecutionPlan::link(const std::vector<int> &lineNumbers,
+                         const std::vector<Statement *> &stmts, const ExecutionPlan *whole) {
+    bool region = whole != nullptr;
+    int count = lineNumbers.size();
+    std::vector<int> exitLines;
+    auto exitTo = [&](int lineNumber) {
+        auto it = std::find(exitLines.begin(), exitLines.end(), lineNumber);
+        if (it == exitLines.end()) it = exitLines.insert(exitLines.end(), lineNumber);
+        return count + (int) (it - exitLines.begin());
+    };
+    if (region && count > 0) {
+        int after = whole->findStep(lineNumbers.back()) + 1;
+        exitTo(after < whole->size() ? whole->steps[after].lineNumber : -1);
+    }
+    steps.resize(count);
+    for (int i = 0; i < count; i++) {
+        PlanStep &step = steps[i];
+        step = {lineNumbers[i], stmts[i], i + 1 < count ? i + 1 : END_OF_PLAN, END_OF_PLAN,
+                false, false, false, END_OF_PLAN};
+        if (region && i + 1 == count) step.next = count;
+        int targetLine = jumpLine(step.stmt);
+        if (targetLine == -1) continue;
+        auto it = std::lower_bound(lineNumbers.begin(), lineNumbers.end(), targetLine);
+        if (it != lineNumbers.end() && *it == targetLine) {
+            if (targetLine != 0) step.target = it - lineNumbers.begin();
+        } else if (!region || whole->findStep(targetLine) == END_OF_PLAN) {
+            step.badTarget = true;
+        } else if (targetLine != 0) {
+            step.target = exitTo(targetLine);
+        }
+    }
+    for (int lineNumber : exitLines) {
+        steps.push_back({lineNumber, nullptr, END_OF_PLAN, END_OF_PLAN, false, false, true,
+                         lineNumber});
+    }
+    threadJumps();
+    markLeaders();
+    invalidateBlocks();
+}
+
+/*
+ * Implementation notes: threadJumps
+ * ---------------------------------
+ * A REM, or a line whose statement did not parse, only passes control
+ * to the next line, and a GOTO with a valid target only passes it on
+ * to that target.  Such a step is "transparent", and every jump or
+ * fall-through into one can go straight to the first step past it.
+ * landing[i] is where control really arrives when it enters step i;
+ * it is found for all steps at once by following each chain and
+ * filling in every step on it, so the whole pass is linear.
+ *
+ * A chain that runs into itself, such as 10 GOTO 20 with 20 GOTO 10,
+ * stops where it closes: the steps of the cycle land on themselves and
+ * the steps leading into it on the step where they enter it, so the
+ * program still loops forever there.  This does not depend on where
+ * the walk started, which lets update rethread a few steps on their
+ * own.  A GOTO whose line does not exist is not transparent: it must
+ * still raise LINE NUMBER ERROR when it runs.
+ *
+ * Fall-through only skips REM steps, never GOTOs.  The steps between a
+ * step and its threaded next then compile to no code, so the backends
+ * that lay the steps out in order need no extra jumps.  An exit step
+ * has no statement but is never transparent.
+ */
+
+void ExecutionPlan::threadJumps() {
+    const int UNVISITED = -2, ON_CHAIN = -3;
+    int count = steps.size();
+    std::vector<int> landing(count, UNVISITED);
+    std::vector<int> chain;
+    for (int i = 0; i < count; i++) {
+        int index = i;
+        while (index != END_OF_PLAN && landing[index] == UNVISITED) {
+            const PlanStep &step = steps[index];
+            StatementType type = step.stmt == nullptr ? REM : step.stmt->getType();
+            if (type == REM && !step.exit) {
+                landing[index] = ON_CHAIN;
+                chain.push_back(index);
+                index = step.next;
+            } else if (type == GOTO && !step.badTarget) {
+                landing[index] = ON_CHAIN;
+                chain.push_back(index);
+                index = step.target;
+            } else {
+                landing[index] = index;
+            }
+        }
+        int end = index == END_OF_PLAN ? END_OF_PLAN : landing[index];
+        if (end == ON_CHAIN) {
+            auto cycle = std::find(chain.begin(), chain.end(), index);
+            for (auto it = cycle; it != chain.end(); ++it) landing[*it] = *it;
+            chain.erase(cycle, chain.end());
+            end = index;
+        }
+        for (int step : chain) landing[step] = end;
+        chain.clear();
+    }
+    std::vector<int> pastRem(count);
+    for (int i = count - 1; i >= 0; i--) {
+        Statement *stmt = steps[i].stmt;
+        bool rem = (stmt == nullptr || stmt->getType() == REM) && !steps[i].exit;
+        int next = steps[i].next;
+        pastRem[i] = !rem ? i : next == END_OF_PLAN ? END_OF_PLAN : pastRem[next];
+    }
+    for (PlanStep &step : steps) {
+        if (step.target != END_OF_PLAN) step.target = landing[step.target];
+        if (step.next != END_OF_PLAN) step.next = pastRem[step.next];
+    }
+}
+
+/*
+ * Implementation notes: markLeaders, isLeader
+ * -------------------------------------------
+ * A step starts a block if it is the first step, the target of a
+ * jump, an exit step, or follows a step that transfers control.
+ * jumpsIn counts the jumps that land on each step, so that update can
+ * tell whether a step is still a target after moving one jump.
+ */
+
+void ExecutionPlan::markLeaders() {
+    int count = steps.size();
+    jumpsIn.assign(count, 0);
+    for (const PlanStep &step : steps) {
+        if (step.target != END_OF_PLAN) jumpsIn[step.target]++;
+    }
+    for (int i = 0; i < count; i++) {
+        steps[i].leader = isLeader(i);
+    }
+}
+
+bool ExecutionPlan::isLeader(int index) const {
+    if (index == 0 || steps[index].exit || jumpsIn[index] > 0) return true;
+    Statement *stmt = steps[index - 1].stmt;
+    if (stmt == nullptr) return false;
+    StatementType type = stmt->getType();
+    return type == GOTO || type == IF || type == END;
+}
+
+/*
+ * Implementation notes: buildBlocks
+ * ---------------------------------
+ * The blocks are cut at the leaders.  Steps that always raise LINE
+ * NUMBER ERROR end their block with no successors.
+ */
+
+void ExecutionPlan::buildBlocks() const {
+    if (blocksBuilt) return;
+    int count = steps.size();
+    blocks.clear();
+    blockOf.resize(count);
+    for (int i = 0; i < count; i++) {
+        if (steps[i].leader) blocks.push_back({i, i, {}});
+        blocks.back().last = i;
+        blockOf[i] = blocks.size() - 1;
+    }
+    for (BasicBlock &block : blocks) {
+        const PlanStep &last = steps[block.last];
+        StatementType type = last.stmt == nullptr ? REM : last.stmt->getType();
+        if (last.badTarget || type == END) continue;
+        if (type != GOTO && last.next != END_OF_PLAN) {
+            block.successors.push_back(blockOf[last.next]);
+        }
+        if ((type == GOTO || type == IF) && last.target != END_OF_PLAN) {
+            int target = blockOf[last.target];
+            if (block.successors.empty() || block.successors[0] != target) {
+                block.successors.push_back(target);
+            }
+        }
+    }
+    blocksBuilt = true;
+}
+
+void ExecutionPlan::invalidateBlocks() {
+    blocksBuilt = false;
+    delete graph;
+    graph = nullptr;
+}
+
+/*
+ * Implementation notes: update
+ * ----------------------------
+ * The edited lines are merged into the steps in one pass.  Entering or
+ * deleting a line moves the steps behind it, as inserting into any
+ * array does, and the indices that point past it move along; replacing
+ * a line moves nothing.  Only the steps whose links may change are
+ * then linked again:
+ *
+ *  - the edited steps and the steps just before where lines were
+ *    entered or deleted, whose fall-through changed;
+ *  - the jumps naming an entered or deleted line, whose target now
+ *    exists or no longer does;
+ *  - every step whose threaded next or target passes through one of
+ *    those, found by walking the REM fall-throughs and the GOTOs that
+ *    name a line backwards from them.
+ *
+ * jumpsTo lists the lines naming each line, for the last two.  The
+ * chains are followed again with the rules of threadJumps, and the
+ * leader flags are redone around the edited steps and the steps whose
+ * jumps land elsewhere now.
+ */
+
+void ExecutionPlan::update(Program &program, const std::set<int> &lineNumbers) {
+    if (lineNumbers.empty()) return;
+    if (lineNumbers.size() * RELINK_RATIO > steps.size()) {
+        relink(program);
+        return;
+    }
+    struct Edit {
+        int lineNumber;
+        int old;
+        Statement *stmt;
+        bool present;
+    };
+    std::vector<Edit> edits;
+    std::vector<int> moved, candidates;
+    for (int lineNumber : lineNumbers) {
+        int old = findStep(lineNumber);
+        bool present = program.findLine(lineNumber);
+        if (old == END_OF_PLAN && !present) continue;
+        Statement *stmt = present ? program.getParsedStatement(lineNumber) : nullptr;
+        removeJump(lineNumber);
+        if (jumpLine(stmt) != -1) addJump(lineNumber, jumpLine(stmt));
+        if (old == END_OF_PLAN || !present) moved.push_back(lineNumber);
+        if (!present && steps[old].target != END_OF_PLAN) {
+            jumpsIn[steps[old].target]--;
+            candidates.push_back(steps[old].target);
+        }
+        edits.push_back({lineNumber, old, stmt, present});
+    }
+    if (edits.empty()) return;
+    std::vector<int> changed, seams;
+    if (!moved.empty()) {
+        int count = steps.size();
+        std::vector<int> newIndex(count, END_OF_PLAN);
+        std::vector<PlanStep> merged;
+        std::vector<int> mergedIn;
+        merged.reserve(count + edits.size());
+        mergedIn.reserve(count + edits.size());
+        size_t e = 0;
+        for (int i = 0; i <= count; i++) {
+            for (; e < edits.size() && (i == count || edits[e].lineNumber < steps[i].lineNumber);
+                 e++) {
+                changed.push_back(merged.size());
+                merged.push_back({edits[e].lineNumber, edits[e].stmt, END_OF_PLAN, END_OF_PLAN,
+                                  false, false, false, END_OF_PLAN});
+                mergedIn.push_back(0);
+            }
+            if (i == count) break;
+            if (e < edits.size() && edits[e].lineNumber == steps[i].lineNumber) {
+                const Edit &edit = edits[e++];
+                if (!edit.present) {
+                    seams.push_back(merged.size());
+                    continue;
+                }
+                changed.push_back(merged.size());
+                steps[i].stmt = edit.stmt;
+            }
+            newIndex[i] = merged.size();
+            merged.push_back(steps[i]);
+            mergedIn.push_back(jumpsIn[i]);
+        }
+        for (PlanStep &step : merged) {
+            if (step.next != END_OF_PLAN) step.next = newIndex[step.next];
+            if (step.target != END_OF_PLAN) step.target = newIndex[step.target];
+        }
+        for (int &candidate : candidates) {
+            candidate = newIndex[candidate];
+        }
+        steps.swap(merged);
+        jumpsIn.swap(mergedIn);
+    } else {
+        for (const Edit &edit : edits) {
+            steps[edit.old].stmt = edit.stmt;
+            changed.push_back(edit.old);
+        }
+    }
+    int count = steps.size();
+    std::vector<int> worklist;
+    std::unordered_set<int> reached, affected;
+    auto reach = [&](int index) {
+        if (index >= 0 && index < count && reached.insert(index).second) {
+            worklist.push_back(index);
+        }
+    };
+    for (int index : changed) {
+        reach(index);
+        reach(index - 1);
+    }
+    for (int index : seams) {
+        reach(index - 1);
+    }
+    for (int lineNumber : moved) {
+        auto it = jumpsTo.find(lineNumber);
+        if (it == jumpsTo.end()) continue;
+        for (int source : it->second) {
+            reach(findStep(source));
+        }
+    }
+    while (!worklist.empty()) {
+        int index = worklist.back();
+        worklist.pop_back();
+        affected.insert(index);
+        if (index > 0) {
+            const PlanStep &prev = steps[index - 1];
+            affected.insert(index - 1);
+            if ((prev.stmt == nullptr || prev.stmt->getType() == REM) && !prev.exit) {
+                reach(index - 1);
+            }
+        }
+        auto it = jumpsTo.find(steps[index].lineNumber);
+        if (it == jumpsTo.end()) continue;
+        for (int source : it->second) {
+            int jump = findStep(source);
+            if (jump == END_OF_PLAN) continue;
+            affected.insert(jump);
+            if (steps[jump].stmt->getType() == GOTO) reach(jump);
+        }
+    }
+    std::vector<int> order(affected.begin(), affected.end());
+    std::sort(order.begin(), order.end());
+    std::unordered_map<int, int> landings, nexts;
+    for (int index : order) {
+        PlanStep &step = steps[index];
+        int oldTarget = step.target;
+        step.next = index + 1 < count ? pastRem(index + 1, nexts) : END_OF_PLAN;
+        int raw = rawTarget(index, step.badTarget);
+        step.target = raw == END_OF_PLAN ? END_OF_PLAN : landing(raw, landings);
+        if (step.target == oldTarget) continue;
+        if (oldTarget != END_OF_PLAN) {
+            jumpsIn[oldTarget]--;
+            candidates.push_back(oldTarget);
+        }
+        if (step.target != END_OF_PLAN) {
+            jumpsIn[step.target]++;
+            candidates.push_back(step.target);
+        }
+    }
+    candidates.push_back(0);
+    for (int index : changed) {
+        candidates.push_back(index);
+        candidates.push_back(index + 1);
+    }
+    for (int index : seams) {
+        candidates.push_back(index);
+    }
+    for (int index : candidates) {
+        if (index >= 0 && index < count) steps[index].leader = isLeader(index);
+    }
+    invalidateBlocks();
+}
+
+/*
+ * Implementation notes: indexJumps, addJump, removeJump
+ * -----------------------------------------------------
+ * jumpLines holds the line each GOTO or IF names, so that the entry of
+ * a line can still be found in jumpsTo once its statement is gone.
+ */
+
+void ExecutionPlan::indexJumps() {
+    jumpLines.clear();
+    jumpsTo.clear();
+    for (const PlanStep &step : steps) {
+        int targetLine = jumpLine(step.stmt);
+        if (targetLine != -1) addJump(step.lineNumber, targetLine);
+    }
+}
+
+void ExecutionPlan::addJump(int source, int target) {
+    jumpLines[source] = target;
+    jumpsTo[target].push_back(source);
+}
+
+void ExecutionPlan::removeJump(int source) {
+    auto it = jumpLines.find(source);
+    if (it == jumpLines.end()) return;
+    std::vector<int> &sources = jumpsTo[it->second];
+    auto found = std::find(sources.begin(), sources.end(), source);
+    *found = sources.back();
+    sources.pop_back();
+    if (sources.empty()) jumpsTo.erase(it->second);
+    jumpLines.erase(it);
+}
+
+/*
+ * Implementation notes: rawTarget, isTransparent, landing, pastRem
+ * ----------------------------------------------------------------
+ * These follow single links of a whole-program plan before threading:
+ * rawTarget resolves the line a jump names, as link does, and the
+ * others walk chains the way threadJumps does.  The memos remember
+ * where every step on a chain walked so far ends, so that a long chain
+ * shared by many jumps is only walked once.
+ */
+
+int ExecutionPlan::rawTarget(int index, bool &bad) const {
+    int targetLine = jumpLine(steps[index].stmt);
+    bad = false;
+    if (targetLine == -1) return END_OF_PLAN;
+    int target = findStep(targetLine);
+    bad = target == END_OF_PLAN;
+    return targetLine == 0 ? END_OF_PLAN : target;
+}
+
+bool ExecutionPlan::isTransparent(int index, int &successor) const {
+    const PlanStep &step = steps[index];
+    StatementType type = step.stmt == nullptr ? REM : step.stmt->getType();
+    if (type == REM && !step.exit) {
+        successor = index + 1 < size() ? index + 1 : END_OF_PLAN;
+        return true;
+    }
+    if (type != GOTO) return false;
+    bool bad;
+    successor = rawTarget(index, bad);
+    return !bad;
+}
+
+int ExecutionPlan::landing(int index, std::unordered_map<int, int> &memo) const {
+    const int ON_CHAIN = -3;
+    std::vector<int> chain;
+    int current = index, end;
+    while (true) {
+        if (current == END_OF_PLAN) {
+            end = END_OF_PLAN;
+            break;
+        }
+        auto found = memo.find(current);
+        if (found != memo.end() && found->second != ON_CHAIN) {
+            end = found->second;
+            break;
+        }
+        if (found != memo.end()) {
+            auto cycle = std::find(chain.begin(), chain.end(), current);
+            for (auto it = cycle; it != chain.end(); ++it) memo[*it] = *it;
+            chain.erase(cycle, chain.end());
+            end = current;
+            break;
+        }
+        int successor;
+        if (!isTransparent(current, successor)) {
+            memo[current] = current;
+            end = current;
+            break;
+        }
+        memo[current] = ON_CHAIN;
+        chain.push_back(current);
+        current = successor;
+    }
+    for (int step : chain) memo[step] = end;
+    return memo[index];
+}
+
+int ExecutionPlan::pastRem(int index, std::unordered_map<int, int> &memo) const {
+    std::vector<int> chain;
+    int current = index;
+    while (current != END_OF_PLAN) {
+        auto found = memo.find(current);
+        if (found != memo.end()) {
+            current = found->second;
+            break;
+        }
+        const PlanStep &step = steps[current];
+        bool rem = (step.stmt == nullptr || step.stmt->getType() == REM) && !step.exit;
+        if (!rem) break;
+        chain.push_back(current);
+        current = current + 1 < size() ? current + 1 : END_OF_PLAN;
+    }
+    for (int step : chain) memo[step] = current;
+    return current;
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * Control flow is handled here from the linked indices; every other
+ * statement runs through its own execute method.  A jump whose target
+ * does not lie after it is a backward jump for the profile.
+ */
+
+int ExecutionPlan::run(EvalState &state, Program &program, int start,
+                       ExecutionProfile *profile, ExecutionHistory *history,
+                       LoopDetector *detector) {
+    int index = steps.empty() ? END_OF_PLAN : start;
+    while (index != END_OF_PLAN) {
+        int current = index;
+        const PlanStep &step = steps[index];
+        if (history != nullptr) history->visit(*this, index, state);
+        if (step.stmt == nullptr) {
+            index = step.next;
+            continue;
+        }
+        switch (step.stmt->getType()) {
+            case GOTO:
+                if (step.badTarget) error("LINE NUMBER ERROR");
+                index = step.target;
+                break;
+            case IF:
+                if (step.badTarget) error("LINE NUMBER ERROR");
+                index = ((IfStmt *) step.stmt)->test(state) ? step.target : step.next;
+                break;
+            case END:
+                return END_OF_PLAN;
+            default:
+                step.stmt->execute(state, program);
+                index = step.next;
+                break;
+        }
+        if (index == END_OF_PLAN || index > current) continue;
+        if (detector != nullptr) detector->check(this, index, state);
+        if (profile != nullptr && profile->count(steps[index].lineNumber)) return index;
+    }
+    return END_OF_PLAN;
+}
+
+int ExecutionPlan::size() const {
+    return steps.size();
+}
+
+const PlanStep &ExecutionPlan::getStep(int index) const {
+    return steps[index];
+}
+
+int ExecutionPlan::getBlockCount() const {
+    buildBlocks();
+    return blocks.size();
+}
+
+const BasicBlock &ExecutionPlan::getBlock(int index) const {
+    buildBlocks();
+    return blocks[index];
+}
+
+int ExecutionPlan::getBlockOf(int step) const {
+    buildBlocks();
+    return blockOf[step];
+}
+
+const ControlFlowGraph &ExecutionPlan::getControlFlowGraph() const {
+    if (graph == nullptr) graph = new ControlFlowGraph(*this);
+    return *graph;
+}
+
+int ExecutionPlan::findStep(int lineNumber) const {
+    auto it = std::lower_bound(steps.begin(), steps.end(), lineNumber,
+                               [](const PlanStep &step, int line) {
+                                   return step.lineNumber < line;
+                               });
+    if (it == steps.end() || it->lineNumber != lineNumber) return END_OF_PLAN;
+    return it - steps.begin();
+}
@@ -0,0 +1,240 @@
+/*
+ * File: plan.h
+ * ------------
+ * This interface exports the ExecutionPlan class, the linked form of
+ * a Program that RUN executes.  Building a plan resolves every line
+ * number once, so that running it never searches the line table.
+ */
+
+#ifndef _plan_h
+#define _plan_h
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "evalstate.hpp"
+#include "profile.hpp"
+#include "program.hpp"
+#include "statement.hpp"
+
+class ExecutionHistory;
+class LoopDetector;
+class ControlFlowGraph;
+
+/*
+ * Type: PlanStep
+ * --------------
+ * One line of the program in execution order.  next is the index of
+ * the step that follows when control falls through, and target is the
+ * resolved index of a GOTO or IF destination.  Both use END_OF_PLAN
+ * when control leaves the program.  A jump whose line does not exist
+ * has badTarget set and raises LINE NUMBER ERROR when it executes.
+ * leader is set if the step starts a basic block.
+ *
+ * Both indices are threaded: they skip the REM lines that control
+ * would only pass through, and target also skips GOTOs, so it points
+ * at the step that really runs next.
+ *
+ * exit is only set in the exit steps of a region plan, which have no
+ * statement and stand for exitLine, the line control leaves the region
+ * to, or END_OF_PLAN when it leaves the program.
+ */
+
+struct PlanStep {
+    int lineNumber;
+    Statement *stmt;
+    int next;
+    int target;
+    bool badTarget;
+    bool leader;
+    bool exit;
+    int exitLine;
+};
+
+/*
+ * Type: BasicBlock
+ * ----------------
+ * A maximal run of steps [first, last] that is only entered at first
+ * and only transfers control at last.  successors holds the indices of
+ * the blocks that may run next.
+ */
+
+struct BasicBlock {
+    int first;
+    int last;
+    std::vector<int> successors;
+};
+
+/*
+ * Constant: END_OF_PLAN
+ * ---------------------
+ * The step index used for "leave the program".
+ */
+
+const int END_OF_PLAN = -1;
+
+/*
+ * Class: ExecutionPlan
+ * --------------------
+ * This class stores the linked steps of a program together with its
+ * basic blocks.  Both the tree walker below and the bytecode compiler
+ * work from a plan rather than from the Program line table.
+ *
+ * Program keeps the plan of the whole program from one RUN to the next
+ * and brings it up to date with update after edits, which relinks only
+ * the edited lines and the jumps whose threading passes through them.
+ * The block list is derived from the leader flags the first time an
+ * analysis asks for it after an edit; RUN itself only needs the flags.
+ * The ControlFlowGraph of the blocks is built the same way, once for
+ * all the analyses that use it.
+ */
+
+class ExecutionPlan {
+
+public:
+
+/*
+ * Constructor: ExecutionPlan
+ * Usage: ExecutionPlan plan(program);
+ * -----------------------------------
+ * Links the program: lays out its lines in order, resolves every jump
+ * target and splits the steps into basic blocks.  The plan refers to
+ * the program's Statement objects and is only valid until the program
+ * is edited, unless update is called with the edited lines.
+ */
+
+    explicit ExecutionPlan(Program &program);
+
+/*
+ * Constructor: ExecutionPlan
+ * Usage: ExecutionPlan region(plan, first, last);
+ * -----------------------------------------------
+ * Links only the steps from first to last of plan, a plan of the whole
+ * program.  Every jump to a line outside the region, and falling off
+ * its last line, goes to an exit step appended after the region's own
+ * steps.  An exit step ends the program as far as analyses of the
+ * plan can tell, so they remain valid for the region on its own.
+ */
+
+    ExecutionPlan(const ExecutionPlan &plan, int first, int last);
+
+/*
+ * Destructor: ~ExecutionPlan
+ * Usage: usually implicit
+ * -----------------------
+ * Frees the control flow graph, if one was built.
+ */
+
+    ~ExecutionPlan();
+
+    ExecutionPlan(const ExecutionPlan &) = delete;
+    ExecutionPlan &operator=(const ExecutionPlan &) = delete;
+
+/*
+ * Method: update
+ * Usage: plan.update(program, lineNumbers);
+ * -----------------------------------------
+ * Brings a plan of the whole program up to date after the lines in
+ * lineNumbers have been entered, replaced or deleted.  Until then the
+ * plan may still point to the statements those edits deleted, so it
+ * must not be used in between.
+ */
+
+    void update(Program &program, const std::set<int> &lineNumbers);
+
+/*
+ * Method: run
+ * Usage: plan.run(state, program);
+ *        int step = plan.run(state, program, start, &profile);
+ * ------------------------------------------------------------
+ * Executes the plan by walking the Statement trees, following the
+ * pre-linked indices for control flow, from its first step or from
+ * step start.  If a profile is given, every backward jump is counted
+ * against the line it lands on, and the walk stops in front of that
+ * line once it is hot and returns its step.  Otherwise the result is
+ * END_OF_PLAN, when the program has ended.  If a history is given, it
+ * sees every step before it runs, and a detector sees every backward
+ * jump.
+ */
+
+    int run(EvalState &state, Program &program, int start = 0,
+            ExecutionProfile *profile = nullptr, ExecutionHistory *history = nullptr,
+            LoopDetector *detector = nullptr);
+
+/*
+ * Methods: size, getStep, getBlockCount, getBlock, getBlockOf
+ * Usage: const PlanStep &step = plan.getStep(i);
+ * ----------------------------------------------
+ * Give read access to the linked steps and their basic blocks.
+ * getBlockOf returns the index of the block holding a step.
+ */
+
+    int size() const;
+
+    const PlanStep &getStep(int index) const;
+
+    int getBlockCount() const;
+
+    const BasicBlock &getBlock(int index) const;
+
+    int getBlockOf(int step) const;
+
+/*
+ * Method: getControlFlowGraph
+ * Usage: const ControlFlowGraph &cfg = plan.getControlFlowGraph();
+ * ----------------------------------------------------------------
+ * Returns the predecessors, dominators and loops of the blocks (see
+ * cfg.h), computed the first time they are asked for.
+ */
+
+    const ControlFlowGraph &getControlFlowGraph() const;
+
+/*
+ * Method: findStep
+ * Usage: int step = plan.findStep(lineNumber);
+ * --------------------------------------------
+ * Returns the step of the given line, or END_OF_PLAN if the plan has
+ * no such line.
+ */
+
+    int findStep(int lineNumber) const;
+
+/*
+ * Constant: RELINK_RATIO
+ * ----------------------
+ * update relinks the whole program instead of patching it when more
+ * than one line in RELINK_RATIO has been edited.
+ */
+
+    static const int RELINK_RATIO = 8;
+
+private:
+
+    void relink(Program &program);
+    void link(const std::vector<int> &lineNumbers, const std::vector<Statement *> &stmts,
+              const ExecutionPlan *whole);
+    void threadJumps();
+    void markLeaders();
+    void buildBlocks() const;
+    void invalidateBlocks();
+    void indexJumps();
+    void addJump(int source, int target);
+    void removeJump(int source);
+    int rawTarget(int index, bool &bad) const;
+    bool isTransparent(int index, int &successor) const;
+    int landing(int index, std::unordered_map<int, int> &memo) const;
+    int pastRem(int index, std::unordered_map<int, int> &memo) const;
+    bool isLeader(int index) const;
+
+    std::vector<PlanStep> steps;
+    std::vector<int> jumpsIn;
+    std::unordered_map<int, int> jumpLines;
+    std::unordered_map<int, std::vector<int>> jumpsTo;
+    mutable std::vector<BasicBlock> blocks;
+    mutable std::vector<int> blockOf;
+    mutable bool blocksBuilt = false;
+    mutable ControlFlowGraph *graph = nullptr;
+
+};
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * File: profile.cpp
+ * -----------------
+ * This file implements the ExecutionProfile class.
+ */
+
+#include "profile.hpp"
+
+bool ExecutionProfile::count(int lineNumber) {
+    int &count = counts[lineNumber];
+    if (count < HOT_THRESHOLD) count++;
+    return count == HOT_THRESHOLD;
+}
+
+void ExecutionProfile::forget(int lineNumber) {
+    counts.erase(lineNumber);
+}
+
+void ExecutionProfile::clear() {
+    counts.clear();
+}
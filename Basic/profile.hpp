@@ -0,0 +1,70 @@
+/*
+ * File: profile.h
+ * ---------------
+ * This interface exports the ExecutionProfile class, which counts how
+ * often the loops of a program run in the tree walker, so that RUN can
+ * move a program to the bytecode once it spends its time in a loop.
+ */
+
+#ifndef _profile_h
+#define _profile_h
+
+#include <unordered_map>
+
+/*
+ * Class: ExecutionProfile
+ * -----------------------
+ * Counts are kept per line number, for the lines that backward jumps
+ * land on.  They survive from one RUN to the next, so a loop that was
+ * hot once is promoted the first time it comes round again, and they
+ * are dropped line by line as the program is edited.
+ */
+
+class ExecutionProfile {
+
+public:
+
+/*
+ * Method: count
+ * Usage: if (profile.count(lineNumber)) . . .
+ * -------------------------------------------
+ * Counts one more backward jump to the line and returns true if the
+ * line has reached HOT_THRESHOLD.
+ */
+
+    bool count(int lineNumber);
+
+/*
+ * Method: forget
+ * Usage: profile.forget(lineNumber);
+ * ----------------------------------
+ * Drops the count of a line that has been entered or deleted.
+ */
+
+    void forget(int lineNumber);
+
+/*
+ * Method: clear
+ * Usage: profile.clear();
+ * -----------------------
+ * Drops every count.
+ */
+
+    void clear();
+
+/*
+ * Constant: HOT_THRESHOLD
+ * -----------------------
+ * The number of backward jumps to a line after which RUN leaves the
+ * tree walker.
+ */
+
+    static const int HOT_THRESHOLD = 100;
+
+private:
+
+    std::unordered_map<int, int> counts;
+
+};
+
+#endif
@@ -9,14 +9,42 @@
  */
 
 #include "program.hpp"
+#include "bytecode.hpp"
+#include "constprop.hpp"
+#include "deadcode.hpp"
+#include "closedform.hpp"
+#include "definite.hpp"
+#include "ranges.hpp"
+#include "region.hpp"
+#include "loopopt.hpp"
+#include "partial.hpp"
+#include "plan.hpp"
+#include "profile.hpp"
+#include "history.hpp"
+#include "jit.hpp"
+#include "options.hpp"
 #include "Utils/error.hpp"
 #include <algorithm>
 
-Program::Program() = default;
+Program::Program() : profile(new ExecutionProfile), history(new ExecutionHistory) {}
 
-Program::~Program() { clear(); }
+Program::~Program() {
+  clear();
+  delete profile;
+  delete history;
+}
 
 void Program::clear() {
+  invalidateAnalyses();
+  delete executionPlan;
+  executionPlan = nullptr;
+  edits.clear();
+  profile->clear();
+  history->clear();
+  for (auto &pair : regions) {
+    delete pair.second;
+  }
+  regions.clear();
   for (auto &pair : parsedStatements) {
     delete pair.second;
   }
@@ -26,6 +54,11 @@ void Program::clear() {
 }
 
 void Program::addSourceLine(int lineNumber, const std::string &line) {
+  invalidateAnalyses();
+  invalidateRegions(lineNumber);
+  profile->forget(lineNumber);
+  history->edit(lineNumber);
+  recordEdit(lineNumber);
   if (sourceLines.find(lineNumber) != sourceLines.end()) {
     sourceLines.erase(lineNumber);
   }
@@ -34,6 +67,11 @@ void Program::addSourceLine(int lineNumber, const std::string &line) {
 }
 
 void Program::removeSourceLine(int lineNumber) {
+  invalidateAnalyses();
+  invalidateRegions(lineNumber);
+  profile->forget(lineNumber);
+  history->edit(lineNumber);
+  recordEdit(lineNumber);
   if (sourceLines.find(lineNumber) != sourceLines.end()) {
     sourceLines.erase(lineNumber);
     lineNumbers.erase(lineNumber);
@@ -53,6 +91,7 @@ std::string Program::getSourceLine(int lineNumber) {
 }
 
 void Program::setParsedStatement(int lineNumber, Statement *stmt) {
+  invalidateAnalyses();
   if (sourceLines.find(lineNumber) == sourceLines.end()) {
     error("LINE NUMBER ERROR");
   } else {
@@ -61,15 +100,13 @@ void Program::setParsedStatement(int lineNumber, Statement *stmt) {
       parsedStatements.erase(lineNumber);
     }
     parsedStatements[lineNumber] = stmt;
+    recordEdit(lineNumber);
   }
 }
 
 Statement *Program::getParsedStatement(int lineNumber) {
-  try {
-    return parsedStatements.at(lineNumber);
-  } catch (std::out_of_range &ex) {
-    return nullptr;
-  }
+  auto it = parsedStatements.find(lineNumber);
+  return it == parsedStatements.end() ? nullptr : it->second;
 }
 
 int Program::getFirstLineNumber() {
@@ -108,4 +145,140 @@ int Program::nextLine() {
 
 bool Program::findLine(int lineNumber) {
   return lineNumbers.find(lineNumber) != lineNumbers.end();
-}
\ No newline at end of file
+}
+
+ExecutionPlan &Program::getPlan() {
+  if (executionPlan == nullptr) {
+    executionPlan = new ExecutionPlan(*this);
+  } else {
+    executionPlan->update(*this, edits);
+  }
+  edits.clear();
+  return *executionPlan;
+}
+
+const ConstantPropagation &Program::getConstants(const ExecutionPlan &plan) {
+  if (constants == nullptr) {
+    constants = new ConstantPropagation(plan);
+  }
+  return *constants;
+}
+
+const LoopOptimizer &Program::getLoops(const ExecutionPlan &plan) {
+  if (loops == nullptr) {
+    loops = new LoopOptimizer(plan);
+  }
+  return *loops;
+}
+
+const DefiniteAssignment &Program::getDefiniteAssignment(const ExecutionPlan &plan) {
+  if (definite == nullptr) {
+    definite = new DefiniteAssignment(plan);
+  }
+  return *definite;
+}
+
+const DeadCode &Program::getDeadCode(const ExecutionPlan &plan) {
+  if (dead == nullptr) {
+    dead = new DeadCode(plan, getConstants(plan), getDefiniteAssignment(plan));
+  }
+  return *dead;
+}
+
+const ValueRanges &Program::getRanges(const ExecutionPlan &plan) {
+  if (ranges == nullptr) {
+    ranges = new ValueRanges(plan);
+  }
+  return *ranges;
+}
+
+const ClosedForms &Program::getClosedForms(const ExecutionPlan &plan) {
+  if (closedForms == nullptr) {
+    closedForms = new ClosedForms(plan);
+  }
+  return *closedForms;
+}
+
+const PartialEvaluation &Program::getPartialEvaluation(const ExecutionPlan &plan) {
+  if (partial == nullptr) {
+    partial = new PartialEvaluation(plan);
+  }
+  return *partial;
+}
+
+BytecodeProgram &Program::getBytecode(const ExecutionPlan &plan, EvalState &state) {
+  if (bytecode == nullptr) {
+    bytecode = new BytecodeProgram(
+        plan, state, options.constantPropagation ? &getConstants(plan) : nullptr,
+        options.loopOptimization ? &getLoops(plan) : nullptr,
+        options.deadCodeElimination ? &getDeadCode(plan) : nullptr,
+        options.definiteAssignment ? &getDefiniteAssignment(plan) : nullptr,
+        options.valueRanges ? &getRanges(plan) : nullptr,
+        options.closedForms ? &getClosedForms(plan) : nullptr);
+    bytecode->setTracing(options.traces);
+  }
+  return *bytecode;
+}
+
+JitProgram *Program::getJit(const ExecutionPlan &plan, EvalState &state) {
+  if (jit == nullptr) {
+    jit = new JitProgram(getBytecode(plan, state));
+  }
+  return jit->isReady() ? jit : nullptr;
+}
+
+ExecutionProfile &Program::getProfile() { return *profile; }
+
+ExecutionHistory &Program::getHistory() { return *history; }
+
+CompiledRegion &Program::getRegion(const ExecutionPlan &plan, int header, EvalState &state) {
+  int lineNumber = plan.getStep(header).lineNumber;
+  auto it = regions.find(lineNumber);
+  if (it == regions.end()) {
+    it = regions.emplace(lineNumber, new CompiledRegion(plan, header, state)).first;
+  }
+  return *it->second;
+}
+
+void Program::invalidateAnalyses() {
+  delete jit;
+  jit = nullptr;
+  delete bytecode;
+  bytecode = nullptr;
+  delete constants;
+  constants = nullptr;
+  delete loops;
+  loops = nullptr;
+  delete dead;
+  dead = nullptr;
+  delete definite;
+  definite = nullptr;
+  delete ranges;
+  ranges = nullptr;
+  delete closedForms;
+  closedForms = nullptr;
+  delete partial;
+  partial = nullptr;
+}
+
+void Program::invalidateRegions(int lineNumber) {
+  for (auto it = regions.begin(); it != regions.end();) {
+    if (it->second->dependsOn(lineNumber)) {
+      delete it->second;
+      it = regions.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/*
+ * Implementation notes: recordEdit
+ * --------------------------------
+ * Edits are only recorded once there is a plan to patch, so that
+ * entering a program does not collect every one of its lines.
+ */
+
+void Program::recordEdit(int lineNumber) {
+  if (executionPlan != nullptr) edits.insert(lineNumber);
+}
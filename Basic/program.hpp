@@ -12,10 +12,25 @@
 #include <vector>
 #include <set>
 #include <unordered_map>
+#include <map>
 #include "statement.hpp"
 
 
 class Statement;
+class ExecutionPlan;
+class ConstantPropagation;
+class LoopOptimizer;
+class ExecutionProfile;
+class ExecutionHistory;
+class CompiledRegion;
+class EvalState;
+class DeadCode;
+class DefiniteAssignment;
+class ValueRanges;
+class ClosedForms;
+class PartialEvaluation;
+class BytecodeProgram;
+class JitProgram;
 
 /*
  * This class stores the lines in a BASIC program.  Each line
@@ -153,6 +168,148 @@ public:
 
     bool findLine(int lineNumber);
 
+/*
+ * Method: getPlan
+ * Usage: ExecutionPlan &plan = program.getPlan();
+ * -----------------------------------------------
+ * Returns the execution plan of the whole program.  The plan is kept
+ * from one RUN to the next, and the lines edited since the last call
+ * are patched into it (see ExecutionPlan::update), so re-running a
+ * program after a few edits does not link all of it again.
+ */
+
+    ExecutionPlan &getPlan();
+
+/*
+ * Method: getConstants
+ * Usage: const ConstantPropagation &constants = program.getConstants(plan);
+ * -------------------------------------------------------------------------
+ * Returns the constant propagation results for the program, running
+ * the analysis over plan, which must have been built from the current
+ * program, the first time after an edit.  addSourceLine,
+ * removeSourceLine, setParsedStatement and clear all discard the
+ * results, so a RUN of an unchanged program reuses them.
+ */
+
+    const ConstantPropagation &getConstants(const ExecutionPlan &plan);
+
+/*
+ * Method: getLoops
+ * Usage: const LoopOptimizer &loops = program.getLoops(plan);
+ * -----------------------------------------------------------
+ * Returns the loop analysis of the program, cached and discarded on
+ * edits like the results of getConstants.
+ */
+
+    const LoopOptimizer &getLoops(const ExecutionPlan &plan);
+
+/*
+ * Method: getDefiniteAssignment
+ * Usage: const DefiniteAssignment &definite = program.getDefiniteAssignment(plan);
+ * --------------------------------------------------------------------------------
+ * Returns the reads of the program that cannot find their variable
+ * unset, cached and discarded on edits like the results of
+ * getConstants.
+ */
+
+    const DefiniteAssignment &getDefiniteAssignment(const ExecutionPlan &plan);
+
+/*
+ * Method: getDeadCode
+ * Usage: const DeadCode &dead = program.getDeadCode(plan);
+ * --------------------------------------------------------
+ * Returns the dead statements of the program, cached and discarded on
+ * edits like the results of getConstants and getDefiniteAssignment,
+ * which it uses.
+ */
+
+    const DeadCode &getDeadCode(const ExecutionPlan &plan);
+
+/*
+ * Method: getRanges
+ * Usage: const ValueRanges &ranges = program.getRanges(plan);
+ * -----------------------------------------------------------
+ * Returns the value ranges of the program, cached and discarded on
+ * edits like the results of getConstants.
+ */
+
+    const ValueRanges &getRanges(const ExecutionPlan &plan);
+
+/*
+ * Method: getClosedForms
+ * Usage: const ClosedForms &closedForms = program.getClosedForms(plan);
+ * ---------------------------------------------------------------------
+ * Returns the counting loops of the program, cached and discarded on
+ * edits like the results of getConstants.
+ */
+
+    const ClosedForms &getClosedForms(const ExecutionPlan &plan);
+
+/*
+ * Method: getPartialEvaluation
+ * Usage: const PartialEvaluation &partial = program.getPartialEvaluation(plan);
+ * -----------------------------------------------------------------------------
+ * Returns the result of evaluating the program ahead of time, cached
+ * and discarded on edits like the results of getConstants.
+ */
+
+    const PartialEvaluation &getPartialEvaluation(const ExecutionPlan &plan);
+
+/*
+ * Method: getBytecode
+ * Usage: BytecodeProgram &code = program.getBytecode(plan, state);
+ * ----------------------------------------------------------------
+ * Returns the whole program compiled to bytecode with the analyses the
+ * options select, binding its variables to the slots of state.  It is
+ * cached and discarded on edits like the results of getConstants.
+ */
+
+    BytecodeProgram &getBytecode(const ExecutionPlan &plan, EvalState &state);
+
+/*
+ * Method: getJit
+ * Usage: JitProgram *jit = program.getJit(plan, state);
+ * -----------------------------------------------------
+ * Returns the native code translated from getBytecode, or NULL if it
+ * cannot be translated on this machine.  It is cached and discarded
+ * along with the bytecode.
+ */
+
+    JitProgram *getJit(const ExecutionPlan &plan, EvalState &state);
+
+/*
+ * Method: getProfile
+ * Usage: ExecutionProfile &profile = program.getProfile();
+ * --------------------------------------------------------
+ * Returns the loop counts RUN uses to decide when to leave the tree
+ * walker.  Unlike the analyses above it is kept across edits, which
+ * only drop the counts of the lines they change.
+ */
+
+    ExecutionProfile &getProfile();
+
+/*
+ * Method: getHistory
+ * Usage: ExecutionHistory &history = program.getHistory();
+ * --------------------------------------------------------
+ * Returns the checkpoints of the last RUN (see history.h).  Every edit
+ * is passed on to the history, which keeps the checkpoints the edit
+ * does not affect.
+ */
+
+    ExecutionHistory &getHistory();
+
+/*
+ * Method: getRegion
+ * Usage: CompiledRegion &region = program.getRegion(plan, header, state);
+ * -----------------------------------------------------------------------
+ * Returns the compiled form of the loop whose header is the given step
+ * of plan.  Regions are cached by header line and, unlike the analyses
+ * above, survive edits that do not touch them (see region.h).
+ */
+
+    CompiledRegion &getRegion(const ExecutionPlan &plan, int header, EvalState &state);
+
 private:
 
     // Fill this in with whatever types and instance variables you need
@@ -160,6 +317,24 @@ private:
     std::unordered_map<int, Statement *> parsedStatements;
     std::set <int> lineNumbers;
     int currentLine = -1;
+    ExecutionPlan *executionPlan = nullptr;
+    std::set<int> edits;
+    ConstantPropagation *constants = nullptr;
+    LoopOptimizer *loops = nullptr;
+    DeadCode *dead = nullptr;
+    DefiniteAssignment *definite = nullptr;
+    ValueRanges *ranges = nullptr;
+    ClosedForms *closedForms = nullptr;
+    PartialEvaluation *partial = nullptr;
+    BytecodeProgram *bytecode = nullptr;
+    JitProgram *jit = nullptr;
+    ExecutionProfile *profile;
+    ExecutionHistory *history;
+    std::map<int, CompiledRegion *> regions;
+
+    void invalidateAnalyses();
+    void invalidateRegions(int lineNumber);
+    void recordEdit(int lineNumber);
 };
 
 #endif
@@ -0,0 +1,496 @@
+/*
+ * File: ranges.cpp
+ * ----------------
+ * This file implements the ValueRanges class.
+ */
+
+#include "ranges.hpp"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <sstream>
+
+namespace {
+
+/*
+ * Type: Range
+ * -----------
+ * The closed interval [low, high].  Bounds are held in 64 bits so that
+ * the exact result of any operation on two int ranges can be formed
+ * before it is checked against the int range.  nonZero records that 0
+ * is excluded even though it lies inside the interval, which is what
+ * the fall-through edge of IF N = 0 proves.
+ */
+
+struct Range {
+    long long low;
+    long long high;
+    bool nonZero;
+};
+
+const Range FULL_RANGE = {INT_MIN, INT_MAX, false};
+
+bool excludesZero(const Range &range) {
+    return range.nonZero || range.low > 0 || range.high < 0;
+}
+
+bool isEmpty(const Range &range) {
+    return range.low > range.high || (range.nonZero && range.low == 0 && range.high == 0);
+}
+
+typedef std::vector<Range> Environment;
+
+/*
+ * Type: Relation
+ * --------------
+ * The comparison an IF edge is known to satisfy, read as
+ * "side relation other".
+ */
+
+enum Relation {
+    EQ, NE, LT, GE, GT, LE
+};
+
+Relation negate(Relation rel) {
+    switch (rel) {
+        case EQ: return NE;
+        case NE: return EQ;
+        case LT: return GE;
+        case GE: return LT;
+        case GT: return LE;
+        default: return GT;
+    }
+}
+
+Relation swapSides(Relation rel) {
+    switch (rel) {
+        case LT: return GT;
+        case GT: return LT;
+        case LE: return GE;
+        case GE: return LE;
+        default: return rel;
+    }
+}
+
+/*
+ * Constant: WIDENING_DELAY
+ * ------------------------
+ * The number of times a block is analyzed before growing bounds at
+ * its entry are widened.
+ */
+
+const int WIDENING_DELAY = 2;
+
+/*
+ * Class: Analyzer
+ * ---------------
+ * Holds the variable numbering, the widening thresholds and the block
+ * entry environments while the analysis runs.
+ */
+
+class Analyzer {
+
+public:
+
+    Analyzer(const ExecutionPlan &plan,
+             std::unordered_map<Expression *, std::pair<int, int>> &ranges,
+             std::unordered_set<Expression *> &safeDivisions,
+             std::unordered_set<Expression *> &overflows,
+             std::vector<std::string> &findings)
+            : plan(plan), ranges(ranges), safeDivisions(safeDivisions),
+              overflows(overflows), findings(findings) {
+    }
+
+    void run();
+
+private:
+
+    int variable(const std::string &name);
+    void collect(Expression *exp);
+    void transfer(int block, Environment &env);
+    void flow(int block, const Environment &env);
+    bool narrow(Environment &env, Expression *side, Range self, Relation rel, Range other,
+                bool pure);
+    Range eval(Expression *exp, Environment &env);
+    bool assigns(Expression *exp) const;
+    long long widenLow(long long bound) const;
+    long long widenHigh(long long bound) const;
+    void note(const std::string &text);
+
+    const ExecutionPlan &plan;
+    std::unordered_map<Expression *, std::pair<int, int>> &ranges;
+    std::unordered_set<Expression *> &safeDivisions;
+    std::unordered_set<Expression *> &overflows;
+    std::vector<std::string> &findings;
+    std::map<std::string, int> variables;
+    std::vector<long long> thresholds;
+    std::vector<Environment> entries;
+    std::vector<char> reached;
+    std::vector<int> visits;
+    std::vector<int> worklist;
+    std::vector<char> queued;
+    bool recording = false;
+    int lineNumber = 0;
+
+};
+
+int Analyzer::variable(const std::string &name) {
+    auto it = variables.find(name);
+    if (it != variables.end()) return it->second;
+    int index = variables.size();
+    variables.emplace(name, index);
+    return index;
+}
+
+void Analyzer::collect(Expression *exp) {
+    if (exp->getType() == CONSTANT) {
+        long long value = ((ConstantExp *) exp)->getValue();
+        for (long long t = value - 1; t <= value + 1; t++) {
+            if (t >= INT_MIN && t <= INT_MAX) thresholds.push_back(t);
+        }
+    } else if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getName());
+    } else {
+        collect(((CompoundExp *) exp)->getLHS());
+        collect(((CompoundExp *) exp)->getRHS());
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * A worklist iteration in which entry ranges only grow.  Before a
+ * block has been analyzed WIDENING_DELAY times its entry ranges grow
+ * to the hull of what flows in; after that a growing bound jumps to
+ * the next threshold, and since there are finitely many thresholds
+ * the iteration terminates.  A last pass over the reached blocks
+ * records the results against the final entry environments.
+ */
+
+void Analyzer::run() {
+    int count = plan.getBlockCount();
+    if (count == 0) return;
+    thresholds = {INT_MIN, INT_MAX};
+    for (int i = 0; i < plan.size(); i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        switch (stmt->getType()) {
+            case LET:
+                variable(((LetStmt *) stmt)->getVar());
+                collect(((LetStmt *) stmt)->getExp());
+                break;
+            case PRINT:
+                collect(((PrintStmt *) stmt)->getExp());
+                break;
+            case INPUT:
+                variable(((InputStmt *) stmt)->getVar());
+                break;
+            case IF:
+                collect(((IfStmt *) stmt)->getLHS());
+                collect(((IfStmt *) stmt)->getRHS());
+                break;
+            default:
+                break;
+        }
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    entries.assign(count, Environment(variables.size(), FULL_RANGE));
+    reached.assign(count, false);
+    visits.assign(count, 0);
+    queued.assign(count, false);
+    reached[0] = true;
+    queued[0] = true;
+    worklist.push_back(0);
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        queued[block] = false;
+        visits[block]++;
+        Environment env = entries[block];
+        transfer(block, env);
+    }
+    recording = true;
+    for (int block = 0; block < count; block++) {
+        if (!reached[block]) continue;
+        Environment env = entries[block];
+        transfer(block, env);
+    }
+}
+
+/*
+ * Implementation notes: transfer
+ * ------------------------------
+ * Runs the statements of a block over env and passes the result on to
+ * the blocks that can follow it.  Expressions are evaluated left to
+ * right, just as at run time.  An IF only narrows a variable it
+ * compares when neither side assigns anything, since otherwise the
+ * value compared need not be the value the variable keeps.
+ */
+
+void Analyzer::transfer(int block, Environment &env) {
+    const BasicBlock &range = plan.getBlock(block);
+    for (int i = range.first; i <= range.last; i++) {
+        const PlanStep &step = plan.getStep(i);
+        Statement *stmt = step.stmt;
+        if (stmt == nullptr) continue;
+        lineNumber = step.lineNumber;
+        switch (stmt->getType()) {
+            case LET: {
+                LetStmt *let = (LetStmt *) stmt;
+                Range value = eval(let->getExp(), env);
+                env[variable(let->getVar())] = value;
+                if (recording) {
+                    std::ostringstream text;
+                    text << let->getVar() << " IN [" << value.low << ", " << value.high << "]";
+                    note(text.str());
+                }
+                break;
+            }
+            case PRINT:
+                eval(((PrintStmt *) stmt)->getExp(), env);
+                break;
+            case INPUT:
+                env[variable(((InputStmt *) stmt)->getVar())] = FULL_RANGE;
+                break;
+            case GOTO:
+                if (step.badTarget || step.target == END_OF_PLAN) return;
+                flow(plan.getBlockOf(step.target), env);
+                return;
+            case IF: {
+                if (step.badTarget) return;
+                IfStmt *ifStmt = (IfStmt *) stmt;
+                Expression *lhs = ifStmt->getLHS(), *rhs = ifStmt->getRHS();
+                Range left = eval(lhs, env);
+                Range right = eval(rhs, env);
+                bool pure = !assigns(lhs) && !assigns(rhs);
+                char op = ifStmt->getOp()[0];
+                Relation rel = op == '=' ? EQ : op == '<' ? LT : GT;
+                if (step.next != END_OF_PLAN) {
+                    Environment fallen = env;
+                    Relation no = negate(rel);
+                    if (narrow(fallen, lhs, left, no, right, pure)
+                        && narrow(fallen, rhs, right, swapSides(no), left, pure)) {
+                        flow(plan.getBlockOf(step.next), fallen);
+                    }
+                }
+                if (step.target != END_OF_PLAN
+                    && narrow(env, lhs, left, rel, right, pure)
+                    && narrow(env, rhs, right, swapSides(rel), left, pure)) {
+                    flow(plan.getBlockOf(step.target), env);
+                }
+                return;
+            }
+            case END:
+                return;
+            default:
+                break;
+        }
+    }
+    const PlanStep &last = plan.getStep(range.last);
+    if (last.next != END_OF_PLAN) flow(plan.getBlockOf(last.next), env);
+}
+
+void Analyzer::flow(int block, const Environment &env) {
+    if (recording) return;
+    Environment &entry = entries[block];
+    bool changed = !reached[block];
+    if (!reached[block]) {
+        reached[block] = true;
+        entry = env;
+    } else {
+        bool widen = visits[block] >= WIDENING_DELAY;
+        for (size_t v = 0; v < env.size(); v++) {
+            if (entry[v].nonZero && !excludesZero(env[v])) {
+                entry[v].nonZero = false;
+                changed = true;
+            }
+            if (env[v].low < entry[v].low) {
+                entry[v].low = widen ? widenLow(env[v].low) : env[v].low;
+                changed = true;
+            }
+            if (env[v].high > entry[v].high) {
+                entry[v].high = widen ? widenHigh(env[v].high) : env[v].high;
+                changed = true;
+            }
+        }
+    }
+    if (changed && !queued[block]) {
+        queued[block] = true;
+        worklist.push_back(block);
+    }
+}
+
+/*
+ * Implementation notes: narrow
+ * ----------------------------
+ * Intersects self, the range of one side of a comparison, with the
+ * values that can satisfy rel against other.  Returns false if none
+ * can, which makes the edge infeasible.  Otherwise a variable on that
+ * side takes the narrowed range.
+ */
+
+bool Analyzer::narrow(Environment &env, Expression *side, Range self, Relation rel,
+                      Range other, bool pure) {
+    switch (rel) {
+        case EQ:
+            self.low = std::max(self.low, other.low);
+            self.high = std::min(self.high, other.high);
+            if (excludesZero(other)) self.nonZero = true;
+            break;
+        case NE:
+            if (other.low == other.high) {
+                if (self.low == other.low) self.low++;
+                if (self.high == other.low) self.high--;
+                if (other.low == 0) self.nonZero = true;
+            }
+            break;
+        case LT:
+            self.high = std::min(self.high, other.high - 1);
+            break;
+        case LE:
+            self.high = std::min(self.high, other.high);
+            break;
+        case GT:
+            self.low = std::max(self.low, other.low + 1);
+            break;
+        case GE:
+            self.low = std::max(self.low, other.low);
+            break;
+    }
+    if (isEmpty(self)) return false;
+    if (pure && side->getType() == IDENTIFIER) {
+        Range &value = env[variable(((IdentifierExp *) side)->getName())];
+        value.low = std::max(value.low, self.low);
+        value.high = std::min(value.high, self.high);
+        value.nonZero = value.nonZero || self.nonZero;
+        if (isEmpty(value)) return false;
+    }
+    return true;
+}
+
+/*
+ * Implementation notes: eval
+ * --------------------------
+ * Mirrors CompoundExp::eval.  A truncating quotient is monotonic in
+ * each operand while the divisor keeps its sign, so a division is
+ * bounded by the corners of the negative and positive parts of the
+ * divisor range.  A node whose evaluation must fail gives FULL_RANGE:
+ * the program stops there, so nothing after it depends on the result.
+ */
+
+Range Analyzer::eval(Expression *exp, Environment &env) {
+    Range result = FULL_RANGE;
+    switch (exp->getType()) {
+        case CONSTANT:
+            result.low = result.high = ((ConstantExp *) exp)->getValue();
+            break;
+        case IDENTIFIER:
+            result = env[variable(((IdentifierExp *) exp)->getName())];
+            break;
+        case COMPOUND: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            std::string op = compound->getOp();
+            Expression *lhs = compound->getLHS();
+            if (op == "=") {
+                if (lhs->getType() != IDENTIFIER || lhs->toString() == "LET") return result;
+                result = eval(compound->getRHS(), env);
+                env[variable(((IdentifierExp *) lhs)->getName())] = result;
+                break;
+            }
+            Range left = eval(lhs, env);
+            Range right = eval(compound->getRHS(), env);
+            std::vector<long long> corners;
+            if (op == "+") {
+                corners = {left.low + right.low, left.high + right.high};
+            } else if (op == "-") {
+                corners = {left.low - right.high, left.high - right.low};
+            } else if (op == "*") {
+                corners = {left.low * right.low, left.low * right.high,
+                           left.high * right.low, left.high * right.high};
+            } else {
+                bool zero = !excludesZero(right);
+                if (recording) {
+                    if (zero) note(exp->toString() + " MAY DIVIDE BY ZERO");
+                    else safeDivisions.insert(exp);
+                }
+                Range parts[] = {{right.low, std::min(right.high, -1LL), true},
+                                 {std::max(right.low, 1LL), right.high, true}};
+                for (const Range &part : parts) {
+                    if (part.low > part.high) continue;
+                    corners.insert(corners.end(), {left.low / part.low, left.low / part.high,
+                                                   left.high / part.low, left.high / part.high});
+                }
+                if (corners.empty()) return result;
+            }
+            result.low = *std::min_element(corners.begin(), corners.end());
+            result.high = *std::max_element(corners.begin(), corners.end());
+            if (result.low < INT_MIN || result.high > INT_MAX) {
+                if (recording) {
+                    overflows.insert(exp);
+                    note(exp->toString() + " MAY OVERFLOW");
+                }
+                result = FULL_RANGE;
+            } else if (op == "*") {
+                result.nonZero = excludesZero(left) && excludesZero(right);
+            }
+            break;
+        }
+    }
+    if (recording) {
+        auto it = ranges.find(exp);
+        if (it == ranges.end()) {
+            ranges.emplace(exp, std::make_pair((int) result.low, (int) result.high));
+        } else {
+            it->second.first = std::min(it->second.first, (int) result.low);
+            it->second.second = std::max(it->second.second, (int) result.high);
+        }
+    }
+    return result;
+}
+
+bool Analyzer::assigns(Expression *exp) const {
+    if (exp->getType() != COMPOUND) return false;
+    CompoundExp *compound = (CompoundExp *) exp;
+    return compound->getOp() == "=" || assigns(compound->getLHS()) || assigns(compound->getRHS());
+}
+
+long long Analyzer::widenLow(long long bound) const {
+    return *(std::upper_bound(thresholds.begin(), thresholds.end(), bound) - 1);
+}
+
+long long Analyzer::widenHigh(long long bound) const {
+    return *std::lower_bound(thresholds.begin(), thresholds.end(), bound);
+}
+
+void Analyzer::note(const std::string &text) {
+    findings.push_back("LINE " + std::to_string(lineNumber) + ": " + text);
+}
+
+}
+
+ValueRanges::ValueRanges(const ExecutionPlan &plan) {
+    Analyzer(plan, ranges, safeDivisions, overflows, findings).run();
+}
+
+bool ValueRanges::getRange(Expression *exp, int &low, int &high) const {
+    auto it = ranges.find(exp);
+    if (it == ranges.end()) return false;
+    low = it->second.first;
+    high = it->second.second;
+    return true;
+}
+
+bool ValueRanges::isSafeDivision(Expression *exp) const {
+    return safeDivisions.count(exp) != 0;
+}
+
+bool ValueRanges::mayOverflow(Expression *exp) const {
+    return overflows.count(exp) != 0;
+}
+
+void ValueRanges::report(std::ostream &os) const {
+    for (const std::string &finding : findings) {
+        os << finding << std::endl;
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * File: ranges.h
+ * --------------
+ * This interface exports the ValueRanges class, a dataflow analysis
+ * over the basic blocks of an ExecutionPlan that bounds the value of
+ * every expression by an interval.  The intervals show which
+ * divisions can never see a zero divisor and which operations can
+ * never overflow 32 bits.
+ */
+
+#ifndef _ranges_h
+#define _ranges_h
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "exp.hpp"
+#include "plan.hpp"
+
+/*
+ * Class: ValueRanges
+ * ------------------
+ * The analysis tracks, for every variable at every block entry, the
+ * smallest and largest value it can hold on any path from the start
+ * of the program.  Since the EvalState survives from one RUN to the
+ * next, every variable may hold any value at the start.  Arithmetic
+ * is done on exact bounds: an operation whose exact result may leave
+ * the int range may overflow, and its result may then be any value.
+ * An IF narrows the variables it compares on each of its two edges,
+ * and an edge whose condition can never hold is not followed.
+ *
+ * At a block that keeps growing, bounds are widened to the nearest
+ * constant of the program, or one past it, so that a counting loop
+ * settles at its limit rather than at the end of the int range.
+ */
+
+class ValueRanges {
+
+public:
+
+/*
+ * Constructor: ValueRanges
+ * Usage: ValueRanges ranges(plan);
+ * --------------------------------
+ * Runs the analysis over plan.  The results refer to the Expression
+ * objects of the plan's statements and stay valid until the program
+ * is edited.
+ */
+
+    explicit ValueRanges(const ExecutionPlan &plan);
+
+/*
+ * Method: getRange
+ * Usage: if (ranges.getRange(exp, low, high)) . . .
+ * -------------------------------------------------
+ * Returns true and sets low and high if exp is reached, in which case
+ * every value it yields lies between them.
+ */
+
+    bool getRange(Expression *exp, int &low, int &high) const;
+
+/*
+ * Method: isSafeDivision
+ * Usage: if (ranges.isSafeDivision(exp)) . . .
+ * --------------------------------------------
+ * Returns true if exp is a division whose divisor is never 0, so that
+ * it cannot raise DIVIDE BY ZERO.
+ */
+
+    bool isSafeDivision(Expression *exp) const;
+
+/*
+ * Method: mayOverflow
+ * Usage: if (ranges.mayOverflow(exp)) . . .
+ * -----------------------------------------
+ * Returns true if exp is an operation whose exact result may not fit
+ * in an int.
+ */
+
+    bool mayOverflow(Expression *exp) const;
+
+/*
+ * Method: report
+ * Usage: ranges.report(std::cerr);
+ * --------------------------------
+ * Writes one line per finding, in program order: the range of every
+ * variable a reached LET assigns, every operation that may overflow
+ * and every division that may divide by zero.
+ */
+
+    void report(std::ostream &os) const;
+
+private:
+
+    std::unordered_map<Expression *, std::pair<int, int>> ranges;
+    std::unordered_set<Expression *> safeDivisions;
+    std::unordered_set<Expression *> overflows;
+    std::vector<std::string> findings;
+
+};
+
+#endif
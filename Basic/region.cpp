@@ -0,0 +1,101 @@
+/*
+ * File: region.cpp
+ * ----------------
+ * This file implements the CompiledRegion class.
+ */
+
+#include "region.hpp"
+#include "options.hpp"
+#include <climits>
+
+/*
+ * Implementation notes: CompiledRegion constructor
+ * ------------------------------------------------
+ * The region starts at the header, or at the REM lines just before it
+ * that a jump back may name instead, and ends at the last step whose
+ * jump lands on the header.  The header is reached from the start of
+ * the region plan through REM lines only, so the analyses, which
+ * assume nothing about the variables where a plan starts, hold at the
+ * header as well.  Dead code elimination needs constant propagation
+ * and definite assignment even when they are not used for anything
+ * else, as in Program::getDeadCode.
+ */
+
+CompiledRegion::CompiledRegion(const ExecutionPlan &plan, int header, EvalState &state) {
+    int first = header;
+    while (first > 0) {
+        Statement *stmt = plan.getStep(first - 1).stmt;
+        if (stmt != nullptr && stmt->getType() != REM) break;
+        first--;
+    }
+    int last = header;
+    for (int i = header; i < plan.size(); i++) {
+        const PlanStep &step = plan.getStep(i);
+        if (step.stmt == nullptr || step.badTarget || step.target != header) continue;
+        StatementType type = step.stmt->getType();
+        if (type == GOTO || type == IF) last = i;
+    }
+    firstLine = plan.getStep(first).lineNumber;
+    lastLine = plan.getStep(last).lineNumber;
+    coverEnd = last + 1 < plan.size() ? plan.getStep(last + 1).lineNumber : INT_MAX;
+    for (int i = first; i <= last; i++) {
+        Statement *stmt = plan.getStep(i).stmt;
+        if (stmt == nullptr) continue;
+        if (stmt->getType() == GOTO) targets.insert(((GotoStmt *) stmt)->getLineNumber());
+        if (stmt->getType() == IF) targets.insert(((IfStmt *) stmt)->getLineNumber());
+    }
+
+    regionPlan = new ExecutionPlan(plan, first, last);
+    if (options.constantPropagation || options.deadCodeElimination) {
+        constants = new ConstantPropagation(*regionPlan);
+    }
+    if (options.definiteAssignment || options.deadCodeElimination) {
+        definite = new DefiniteAssignment(*regionPlan);
+    }
+    if (options.loopOptimization) loops = new LoopOptimizer(*regionPlan);
+    if (options.deadCodeElimination) dead = new DeadCode(*regionPlan, *constants, *definite);
+    if (options.valueRanges) ranges = new ValueRanges(*regionPlan);
+    if (options.closedForms) closedForms = new ClosedForms(*regionPlan);
+    code = new BytecodeProgram(*regionPlan, state,
+                               options.constantPropagation ? constants : nullptr, loops,
+                               dead, options.definiteAssignment ? definite : nullptr,
+                               ranges, closedForms);
+    code->setTracing(options.traces);
+    entry = code->getEntry(header - first);
+    if (options.jit) {
+        jit = new JitProgram(*code);
+        if (!jit->isReady()) {
+            delete jit;
+            jit = nullptr;
+        }
+    }
+}
+
+CompiledRegion::~CompiledRegion() {
+    delete jit;
+    delete code;
+    delete closedForms;
+    delete ranges;
+    delete dead;
+    delete loops;
+    delete definite;
+    delete constants;
+    delete regionPlan;
+}
+
+int CompiledRegion::run(EvalState &state, LoopDetector *detector) {
+    if (jit != nullptr) return jit->run(state, entry);
+    return code->run(state, entry, detector);
+}
+
+bool CompiledRegion::dependsOn(int lineNumber) const {
+    return (lineNumber >= firstLine && lineNumber <= coverEnd) || targets.count(lineNumber);
+}
+
+int CompiledRegion::getFirstLine() const {
+    return firstLine;
+}
+
+int CompiledRegion::getLastLine() const {
+    return lastLine;
+}
@@ -0,0 +1,123 @@
+/*
+ * File: region.h
+ * --------------
+ * This interface exports the CompiledRegion class, the compiled form
+ * of one hot loop of a program.  Program keeps the regions it has
+ * compiled from one RUN to the next and throws away only those an
+ * edit touches, so editing a large program does not force compiling
+ * all of it again.
+ */
+
+#ifndef _region_h
+#define _region_h
+
+#include <set>
+#include "bytecode.hpp"
+#include "closedform.hpp"
+#include "constprop.hpp"
+#include "deadcode.hpp"
+#include "definite.hpp"
+#include "evalstate.hpp"
+#include "jit.hpp"
+#include "loopdetect.hpp"
+#include "loopopt.hpp"
+#include "plan.hpp"
+#include "program.hpp"
+#include "ranges.hpp"
+
+/*
+ * Class: CompiledRegion
+ * ---------------------
+ * A region is the run of lines from a loop header to the last line
+ * that jumps back to it.  It is linked as a region plan, analyzed and
+ * compiled to bytecode on its own, with the optimizations selected in
+ * options, so its cost depends on the size of the loop and not on the
+ * size of the program.  Jumps out of the region leave the compiled
+ * code by line number, and the caller carries on from that line in
+ * the tree walker.
+ *
+ * The compiled code depends on the lines the region covers, on the
+ * line after the last one, where falling off the region goes, and on
+ * the lines its jumps name, whose existence decides between leaving
+ * the region and LINE NUMBER ERROR.  An edit of any other line leaves
+ * the region valid.
+ */
+
+class CompiledRegion {
+
+public:
+
+/*
+ * Constructor: CompiledRegion
+ * Usage: CompiledRegion region(plan, header, state);
+ * --------------------------------------------------
+ * Compiles the loop whose header is the given step of plan, a plan of
+ * the whole program, binding its variables to the slots of state.
+ */
+
+    CompiledRegion(const ExecutionPlan &plan, int header, EvalState &state);
+
+/*
+ * Destructor: ~CompiledRegion
+ * Usage: usually implicit
+ * -----------------------
+ * Frees the compiled code and the analyses it was compiled from.
+ */
+
+    ~CompiledRegion();
+
+    CompiledRegion(const CompiledRegion &) = delete;
+    CompiledRegion &operator=(const CompiledRegion &) = delete;
+
+/*
+ * Method: run
+ * Usage: int line = region.run(state);
+ *        int line = region.run(state, &detector);
+ * ------------------------------------------------
+ * Runs the region from its header and returns the line at which
+ * control leaves it, or END_OF_PLAN if the program ends inside it.
+ * The detector, if given, sees the backward jumps of the region.
+ */
+
+    int run(EvalState &state, LoopDetector *detector = nullptr);
+
+/*
+ * Method: dependsOn
+ * Usage: if (region.dependsOn(lineNumber)) . . .
+ * ----------------------------------------------
+ * Returns true if entering or deleting the line invalidates the region.
+ */
+
+    bool dependsOn(int lineNumber) const;
+
+/*
+ * Methods: getFirstLine, getLastLine
+ * Usage: int first = region.getFirstLine();
+ * -----------------------------------------
+ * Return the first and the last line the region covers.
+ */
+
+    int getFirstLine() const;
+
+    int getLastLine() const;
+
+private:
+
+    ExecutionPlan *regionPlan = nullptr;
+    ConstantPropagation *constants = nullptr;
+    LoopOptimizer *loops = nullptr;
+    DefiniteAssignment *definite = nullptr;
+    DeadCode *dead = nullptr;
+    ValueRanges *ranges = nullptr;
+    ClosedForms *closedForms = nullptr;
+    BytecodeProgram *code = nullptr;
+    JitProgram *jit = nullptr;
+    int entry = 0;
+    int firstLine;
+    int lastLine;
+    int coverEnd;
+    std::set<int> targets;
+
+};
+
+#endif
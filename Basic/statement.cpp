@@ -17,6 +17,54 @@ bool isDecimal(const std::string &input);
 
 int stringToInt(std::string str);
 
+/*
+ * Implementation notes: fused forms
+ * ---------------------------------
+ * The fused forms read their operands in the same order as the
+ * expression tree would, so they raise VARIABLE NOT DEFINED for the
+ * same variable.  fusedCounts is indexed by FusedForm.
+ */
+
+static long fusedCounts[FUSED_FORM_COUNT];
+
+static bool isLeaf(Expression *exp) {
+  return exp->getType() == CONSTANT || exp->getType() == IDENTIFIER;
+}
+
+static FusedOperand makeOperand(Expression *exp) {
+  FusedOperand operand;
+  operand.exp = exp;
+  operand.constant = exp->getType() == CONSTANT;
+  if (operand.constant) {
+    operand.value = ((ConstantExp *) exp)->getValue();
+  }
+  return operand;
+}
+
+static void bindOperand(FusedOperand &operand, EvalState &state) {
+  if (!operand.constant) {
+    operand.value = state.getSlot(((IdentifierExp *) operand.exp)->getName());
+  }
+}
+
+static int fetchOperand(const FusedOperand &operand, EvalState &state) {
+  if (operand.constant) {
+    return operand.value;
+  }
+  if (!state.isSlotDefined(operand.value)) {
+    error("VARIABLE NOT DEFINED");
+  }
+  return state.getSlotValue(operand.value);
+}
+
+void printFusionCounts(std::ostream &os) {
+  static const char *const NAMES[FUSED_FORM_COUNT] = {
+      nullptr, "increment", "accumulate", "compare-const", "compare-var"};
+  for (int form = FUSED_INCREMENT; form < FUSED_FORM_COUNT; form++) {
+    os << NAMES[form] << ": " << fusedCounts[form] << std::endl;
+  }
+}
+
 Statement::Statement() = default;
 
 Statement::~Statement() = default;
@@ -27,6 +75,8 @@ void RemStmt::execute(EvalState &state, Program &program) {
   // do nothing
 }
 
+StatementType RemStmt::getType() { return REM; }
+
 LetStmt::LetStmt(TokenScanner &scanner) {
   try {
     var = scanner.nextToken();
@@ -51,18 +101,106 @@ LetStmt::LetStmt(TokenScanner &scanner) {
   } catch (ErrorException &ex) {
     error("SYNTAX ERROR");
   }
+  fuse();
+}
+
+/*
+ * Implementation notes: LetStmt::fuse
+ * -----------------------------------
+ * Both fused forms update var from its own value, so the right side
+ * must be a sum or difference whose left operand is var itself.
+ * LET S = S + V is an accumulation of V * 1, which reads V exactly
+ * once and gives the same value.  The step of a decrement is negated
+ * in unsigned arithmetic, since the constant may be INT_MIN.
+ */
+
+void LetStmt::fuse() {
+  if (exp->getType() != COMPOUND) {
+    return;
+  }
+  CompoundExp *sum = (CompoundExp *) exp;
+  std::string op = sum->getOp();
+  Expression *lhs = sum->getLHS();
+  Expression *rhs = sum->getRHS();
+  if ((op != "+" && op != "-") || lhs->getType() != IDENTIFIER ||
+      ((IdentifierExp *) lhs)->getName() != var) {
+    return;
+  }
+  if (rhs->getType() == CONSTANT) {
+    int value = ((ConstantExp *) rhs)->getValue();
+    form = FUSED_INCREMENT;
+    step = op == "+" ? value : (int) (0u - (unsigned) value);
+  } else if (op == "+" && rhs->getType() == IDENTIFIER) {
+    form = FUSED_ACCUMULATE;
+    factor1 = makeOperand(rhs);
+    factor2.constant = true;
+    factor2.value = 1;
+  } else if (op == "+" && rhs->getType() == COMPOUND && rhs->getOp() == "*" &&
+             isLeaf(((CompoundExp *) rhs)->getLHS()) &&
+             isLeaf(((CompoundExp *) rhs)->getRHS())) {
+    form = FUSED_ACCUMULATE;
+    factor1 = makeOperand(((CompoundExp *) rhs)->getLHS());
+    factor2 = makeOperand(((CompoundExp *) rhs)->getRHS());
+  }
 }
 
-LetStmt::~LetStmt() { delete exp; }
+LetStmt::~LetStmt() {
+  delete exp;
+  delete compiled;
+}
 
 void LetStmt::execute(EvalState &state, Program &program) {
-  try {
-    state.setValue(var, exp->eval(state));
-  } catch (ErrorException &ex) {
-    error(ex.getMessage());
+  if (compiledFor != &state) {
+    compile(state);
+  }
+  switch (form) {
+  case FUSED_INCREMENT:
+    fusedCounts[form]++;
+    if (!state.isSlotDefined(slot)) {
+      error("VARIABLE NOT DEFINED");
+    }
+    state.setSlotValue(slot, state.getSlotValue(slot) + step);
+    break;
+  case FUSED_ACCUMULATE: {
+    fusedCounts[form]++;
+    if (!state.isSlotDefined(slot)) {
+      error("VARIABLE NOT DEFINED");
+    }
+    int a = fetchOperand(factor1, state);
+    int b = fetchOperand(factor2, state);
+    state.setSlotValue(slot, state.getSlotValue(slot) + a * b);
+    break;
+  }
+  default:
+    try {
+      state.setSlotValue(slot, compiled->eval(state));
+    } catch (ErrorException &ex) {
+      error(ex.getMessage());
+    }
+    break;
   }
 }
 
+void LetStmt::compile(EvalState &state) {
+  slot = state.getSlot(var);
+  compiledFor = &state;
+  if (form == FUSED_ACCUMULATE) {
+    bindOperand(factor1, state);
+    bindOperand(factor2, state);
+  }
+  if (form != NOT_FUSED) {
+    return;
+  }
+  delete compiled;
+  compiled = new CompiledExp(exp, state);
+}
+
+StatementType LetStmt::getType() { return LET; }
+
+std::string LetStmt::getVar() { return var; }
+
+Expression *LetStmt::getExp() { return exp; }
+
 PrintStmt::PrintStmt(TokenScanner &scanner) : exp(nullptr) {
   try {
     exp = parseExp(scanner, false);
@@ -78,18 +216,33 @@ PrintStmt::~PrintStmt() {
   if (exp != nullptr) {
     delete exp;
   }
+  delete compiled;
 }
 
 void PrintStmt::execute(EvalState &state, Program &program) {
+  if (exp == nullptr) {
+    return;
+  }
+  if (compiledFor != &state) {
+    compile(state);
+  }
   try {
-    if (exp != nullptr) {
-      std::cout << exp->eval(state) << std::endl;
-    }
+    std::cout << compiled->eval(state) << std::endl;
   } catch (ErrorException &ex) {
     error(ex.getMessage());
   }
 }
 
+void PrintStmt::compile(EvalState &state) {
+  delete compiled;
+  compiled = new CompiledExp(exp, state);
+  compiledFor = &state;
+}
+
+StatementType PrintStmt::getType() { return PRINT; }
+
+Expression *PrintStmt::getExp() { return exp; }
+
 InputStmt::InputStmt(TokenScanner &scanner) {
   try {
     var = scanner.nextToken();
@@ -102,6 +255,20 @@ InputStmt::InputStmt(TokenScanner &scanner) {
 }
 
 void InputStmt::execute(EvalState &state, Program &program) {
+  int value = readValue();
+
+  try {
+    state.setValue(var, value);
+  } catch (...) {
+    error("INVALID NUMBER");
+  }
+}
+
+StatementType InputStmt::getType() { return INPUT; }
+
+std::string InputStmt::getVar() { return var; }
+
+int InputStmt::readValue() {
   std::string input;
   int value;
   while (true) {
@@ -118,12 +285,7 @@ void InputStmt::execute(EvalState &state, Program &program) {
       }
     }
   }
-
-  try {
-    state.setValue(var, value);
-  } catch (...) {
-    error("INVALID NUMBER");
-  }
+  return value;
 }
 
 GotoStmt::GotoStmt(TokenScanner &scanner) {
@@ -149,6 +311,10 @@ void GotoStmt::execute(EvalState &state, Program &program) {
   }
 }
 
+StatementType GotoStmt::getType() { return GOTO; }
+
+int GotoStmt::getLineNumber() { return lineNumber; }
+
 IfStmt::IfStmt(TokenScanner &scanner, std::string sourceLine) {
   try {
     int pos_start = scanner.getPosition();
@@ -192,30 +358,85 @@ IfStmt::IfStmt(TokenScanner &scanner, std::string sourceLine) {
     }
     error("SYNTAX ERROR");
   }
+  fuse();
+}
+
+void IfStmt::fuse() {
+  if (exp1->getType() != IDENTIFIER || !isLeaf(exp2)) {
+    return;
+  }
+  form = exp2->getType() == CONSTANT ? FUSED_COMPARE_CONST : FUSED_COMPARE_VAR;
+  operand1 = makeOperand(exp1);
+  operand2 = makeOperand(exp2);
 }
 
 void IfStmt::execute(EvalState &state, Program &program) {
   if (!program.findLine(lineNumber)) {
     error("LINE NUMBER ERROR");
   }
+  if (test(state)) {
+    program.setCurrentLine(lineNumber - 1);
+  }
+}
+
+bool IfStmt::test(EvalState &state) {
+  if (compiledFor != &state) {
+    compile(state);
+  }
   try {
-    if (op == "=" && exp1->eval(state) == exp2->eval(state)) {
-      program.setCurrentLine(lineNumber - 1);
-    } else if (op == "<" && exp1->eval(state) < exp2->eval(state)) {
-      program.setCurrentLine(lineNumber - 1);
-    } else if (op == ">" && exp1->eval(state) > exp2->eval(state)) {
-      program.setCurrentLine(lineNumber - 1);
+    int lhs, rhs;
+    if (form != NOT_FUSED) {
+      fusedCounts[form]++;
+      lhs = fetchOperand(operand1, state);
+      rhs = fetchOperand(operand2, state);
+    } else {
+      lhs = compiled1->eval(state);
+      rhs = compiled2->eval(state);
+    }
+    switch (op[0]) {
+    case '=':
+      return lhs == rhs;
+    case '<':
+      return lhs < rhs;
+    case '>':
+      return lhs > rhs;
     }
   } catch (ErrorException &ex) {
     error(ex.getMessage());
   }
+  return false;
+}
+
+void IfStmt::compile(EvalState &state) {
+  compiledFor = &state;
+  if (form != NOT_FUSED) {
+    bindOperand(operand1, state);
+    bindOperand(operand2, state);
+    return;
+  }
+  delete compiled1;
+  delete compiled2;
+  compiled1 = new CompiledExp(exp1, state);
+  compiled2 = new CompiledExp(exp2, state);
 }
 
 IfStmt::~IfStmt() {
   delete exp1;
   delete exp2;
+  delete compiled1;
+  delete compiled2;
 }
 
+StatementType IfStmt::getType() { return IF; }
+
+Expression *IfStmt::getLHS() { return exp1; }
+
+std::string IfStmt::getOp() { return op; }
+
+Expression *IfStmt::getRHS() { return exp2; }
+
+int IfStmt::getLineNumber() { return lineNumber; }
+
 EndStmt::EndStmt(TokenScanner &scanner) {
   if (scanner.hasMoreTokens()) {
     error("SYNTAX ERROR");
@@ -226,6 +447,8 @@ void EndStmt::execute(EvalState &state, Program &program) {
   program.setCurrentLine(-1);
 }
 
+StatementType EndStmt::getType() { return END; }
+
 bool isDecimal(const std::string &input) {
   if (input.empty())
     return false;
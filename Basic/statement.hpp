@@ -17,6 +17,7 @@
 #include <cstdlib>
 #include "evalstate.hpp"
 #include "exp.hpp"
+#include "compiledexp.hpp"
 #include "Utils/tokenScanner.hpp"
 #include "program.hpp"
 #include "parser.hpp"
@@ -25,6 +26,64 @@
 
 class Program;
 
+/*
+ * Type: StatementType
+ * -------------------
+ * This enumerated type is used to differentiate the statement forms
+ * that can appear in a program line.  Like ExpressionType, it lets
+ * clients such as the bytecode compiler inspect a parsed statement
+ * without executing it.
+ */
+
+enum StatementType {
+    REM, LET, PRINT, INPUT, GOTO, IF, END
+};
+
+/*
+ * Type: FusedForm
+ * ---------------
+ * LetStmt and IfStmt recognize a few common idioms when they are
+ * parsed and execute them in one step, without evaluating a
+ * CompiledExp.  V and S stand for variables, c for a constant, and a
+ * and b for either one.
+ *
+ *  FUSED_INCREMENT      LET V = V + c, LET V = V - c
+ *  FUSED_ACCUMULATE     LET S = S + a * b, LET S = S + V
+ *  FUSED_COMPARE_CONST  IF V op c THEN n
+ *  FUSED_COMPARE_VAR    IF V op W THEN n
+ *
+ * GOTO needs no fused form, since the plan already links it to the
+ * index of its target.
+ */
+
+enum FusedForm {
+    NOT_FUSED, FUSED_INCREMENT, FUSED_ACCUMULATE,
+    FUSED_COMPARE_CONST, FUSED_COMPARE_VAR, FUSED_FORM_COUNT
+};
+
+/*
+ * Type: FusedOperand
+ * ------------------
+ * A leaf operand of a fused statement.  exp points into the parsed
+ * expression tree; value holds the constant, or the slot of the
+ * variable once the statement has compiled.
+ */
+
+struct FusedOperand {
+    Expression *exp = nullptr;
+    bool constant = false;
+    int value = 0;
+};
+
+/*
+ * Function: printFusionCounts
+ * Usage: printFusionCounts(std::cerr);
+ * ------------------------------------
+ * Writes how many times each fused form has executed in this process.
+ */
+
+void printFusionCounts(std::ostream &os);
+
 /*
  * Class: Statement
  * ----------------
@@ -72,6 +131,16 @@ public:
 
     virtual void execute(EvalState &state, Program &program) = 0;
 
+/*
+ * Method: getType
+ * Usage: StatementType type = stmt->getType();
+ * --------------------------------------------
+ * Returns the type of the statement, which must be one of the
+ * constants of StatementType.
+ */
+
+    virtual StatementType getType() = 0;
+
 };
 
 
@@ -86,10 +155,22 @@ public:
  * specify its own destructor method to free that memory.
  */
 
+/*
+ * The accessor methods on each subclass (getVar, getExp and so on)
+ * return the components of the parsed statement and follow the model
+ * of getOp, getLHS and getRHS in CompoundExp.
+ *
+ * Statements that evaluate expressions compile them into CompiledExp
+ * form the first time they execute against a given EvalState, and
+ * evaluate the compiled form from then on.  A statement with a fused
+ * form only binds the slots of its operands.
+ */
+
 class RemStmt : public Statement {
 public:
     RemStmt(TokenScanner &scanner);
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
 };
 
 class LetStmt : public Statement {
@@ -97,9 +178,20 @@ public:
     LetStmt(TokenScanner &scanner);
     ~LetStmt();
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
+    std::string getVar();
+    Expression *getExp();
 private:
+    void fuse();
+    void compile(EvalState &state);
     Expression *exp;
     std::string var;
+    CompiledExp *compiled = nullptr;
+    EvalState *compiledFor = nullptr;
+    int slot = 0;
+    FusedForm form = NOT_FUSED;
+    int step = 0;
+    FusedOperand factor1, factor2;
 };
 
 class PrintStmt : public Statement {
@@ -107,14 +199,31 @@ public:
     PrintStmt(TokenScanner &scanner);
     ~PrintStmt();
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
+    Expression *getExp();
 private:
+    void compile(EvalState &state);
     Expression *exp;
+    CompiledExp *compiled = nullptr;
+    EvalState *compiledFor = nullptr;
 };
 
 class InputStmt : public Statement {
 public:
     InputStmt(TokenScanner &scanner);
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
+    std::string getVar();
+
+/*
+ * Method: readValue
+ * Usage: int value = InputStmt::readValue();
+ * ------------------------------------------
+ * Prompts with " ? " and reads lines from std::cin until one of them
+ * is a valid integer, reporting INVALID NUMBER for each rejected line.
+ */
+
+    static int readValue();
 private:
     std::string var;
 };
@@ -123,6 +232,8 @@ class GotoStmt : public Statement {
 public:
     GotoStmt(TokenScanner &scanner);
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
+    int getLineNumber();
 private:
     int lineNumber;
 };
@@ -132,16 +243,38 @@ public:
     IfStmt(TokenScanner &scanner, std::string sourceLine);
     ~IfStmt();
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
+
+/*
+ * Method: test
+ * Usage: if (ifStmt->test(state)) . . .
+ * -------------------------------------
+ * Evaluates the condition of the IF statement without jumping.
+ */
+
+    bool test(EvalState &state);
+
+    Expression *getLHS();
+    std::string getOp();
+    Expression *getRHS();
+    int getLineNumber();
 private:
+    void fuse();
+    void compile(EvalState &state);
     Expression *exp1 = nullptr, *exp2 = nullptr;
     std::string op;
     int lineNumber;
+    CompiledExp *compiled1 = nullptr, *compiled2 = nullptr;
+    EvalState *compiledFor = nullptr;
+    FusedForm form = NOT_FUSED;
+    FusedOperand operand1, operand2;
 };
 
 class EndStmt : public Statement {
 public:
     EndStmt(TokenScanner &scanner);
     void execute(EvalState &state, Program &program) override;
+    StatementType getType() override;
 };
 
 #endif
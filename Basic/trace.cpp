@@ -0,0 +1,206 @@
+/*
+ * File: trace.cpp
+ * ---------------
+ * This file implements the Trace class declared in trace.h.
+ */
+
+#include "trace.hpp"
+#include "statement.hpp"
+#include "Utils/error.hpp"
+#include <iostream>
+#include <unordered_set>
+
+/*
+ * Implementation notes: Trace constructor
+ * ---------------------------------------
+ * The path is rebuilt by walking the bytecode from head: straight-line
+ * instructions are copied, unconditional jumps are followed, and each
+ * conditional jump consumes the next recorded decision.  A load whose
+ * slot has not been written earlier on the path is a trace input and
+ * is checked by canEnter instead.  Since nothing can undefine a
+ * variable during RUN, those inputs stay defined on later iterations.
+ * An OP_FETCH is known to be defined and is never an input.  A path
+ * through an OP_CLOSED is not traced: the closed loop is cheap to run
+ * from the interpreter, and the trace would have to guard its result.
+ */
+
+Trace::Trace(const std::vector<Instruction> &code, int head,
+             const std::vector<BranchDecision> &decisions) {
+    std::unordered_set<int> stored, inputs;
+    size_t next = 0;
+    int pc = head;
+    for (int length = 0; length < MAX_LENGTH; length++) {
+        const Instruction &ins = code[pc];
+        switch (ins.op) {
+            case OP_CONST: {
+                OpCode following = code[pc + 1].op;
+                if (following == OP_ADD || following == OP_SUB || following == OP_MUL
+                    || ((following == OP_DIV || following == OP_QUOT) && ins.operand != 0)) {
+                    TraceOp fused = following == OP_ADD ? TR_ADD_CONST
+                                    : following == OP_SUB ? TR_SUB_CONST
+                                    : following == OP_MUL ? TR_MUL_CONST : TR_DIV_CONST;
+                    ops.push_back({fused, ins.operand});
+                    pc += 2;
+                } else {
+                    ops.push_back({TR_CONST, ins.operand});
+                    pc++;
+                }
+                continue;
+            }
+            case OP_LOAD:
+                if (!stored.count(ins.operand) && inputs.insert(ins.operand).second) {
+                    entrySlots.push_back(ins.operand);
+                }
+                ops.push_back({TR_LOAD, ins.operand});
+                pc++;
+                continue;
+            case OP_FETCH:
+                ops.push_back({TR_LOAD, ins.operand});
+                pc++;
+                continue;
+            case OP_DEFINED:
+                ops.push_back({TR_DEFINED, ins.operand});
+                pc++;
+                continue;
+            case OP_STORE: case OP_ASSIGN: case OP_INPUT:
+                stored.insert(ins.operand);
+                ops.push_back({ins.op == OP_STORE ? TR_STORE
+                               : ins.op == OP_ASSIGN ? TR_ASSIGN : TR_INPUT, ins.operand});
+                pc++;
+                continue;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_QUOT: case OP_PRINT:
+                ops.push_back({ins.op == OP_ADD ? TR_ADD : ins.op == OP_SUB ? TR_SUB
+                               : ins.op == OP_MUL ? TR_MUL : ins.op == OP_DIV ? TR_DIV
+                               : ins.op == OP_QUOT ? TR_QUOT : TR_PRINT, 0});
+                pc++;
+                continue;
+            case OP_JUMP:
+                if (next >= decisions.size() || decisions[next].first != pc) return;
+                next++;
+                pc = ins.operand;
+                break;
+            case OP_JUMP_EQ: case OP_JUMP_LT: case OP_JUMP_GT: {
+                if (next >= decisions.size() || decisions[next].first != pc) return;
+                bool taken = decisions[next++].second;
+                TraceOp guard;
+                if (ins.op == OP_JUMP_EQ) guard = taken ? TR_GUARD_EQ : TR_GUARD_NE;
+                else if (ins.op == OP_JUMP_LT) guard = taken ? TR_GUARD_LT : TR_GUARD_GE;
+                else guard = taken ? TR_GUARD_GT : TR_GUARD_LE;
+                ops.push_back({guard, taken ? pc + 1 : ins.operand});
+                pc = taken ? ins.operand : pc + 1;
+                break;
+            }
+            case OP_CLOSED: case OP_END: case OP_EXIT: case OP_ERROR:
+                return;
+        }
+        if (pc == head) {
+            if (next != decisions.size()) return;
+            ops.push_back({TR_LOOP, 0});
+            valid = true;
+            return;
+        }
+    }
+}
+
+bool Trace::isValid() const {
+    return valid;
+}
+
+bool Trace::canEnter(const EvalState &state) const {
+    for (int slot : entrySlots) {
+        if (!state.isSlotDefined(slot)) return false;
+    }
+    return true;
+}
+
+int Trace::run(EvalState &state, int *stack) const {
+    int *sp = stack;
+    const TraceInstruction *start = ops.data();
+    const TraceInstruction *pc = start;
+    while (true) {
+        const TraceInstruction &ins = *pc++;
+        switch (ins.op) {
+            case TR_CONST:
+                *sp++ = ins.operand;
+                break;
+            case TR_LOAD:
+                *sp++ = state.getSlotValue(ins.operand);
+                break;
+            case TR_DEFINED:
+                *sp++ = state.isSlotDefined(ins.operand) ? 1 : 0;
+                break;
+            case TR_STORE:
+                state.setSlotValue(ins.operand, *--sp);
+                break;
+            case TR_ASSIGN:
+                state.setSlotValue(ins.operand, sp[-1]);
+                break;
+            case TR_ADD:
+                sp--;
+                sp[-1] = sp[-1] + sp[0];
+                break;
+            case TR_SUB:
+                sp--;
+                sp[-1] = sp[-1] - sp[0];
+                break;
+            case TR_MUL:
+                sp--;
+                sp[-1] = sp[-1] * sp[0];
+                break;
+            case TR_DIV:
+                sp--;
+                if (sp[0] == 0) error("DIVIDE BY ZERO");
+                sp[-1] = sp[-1] / sp[0];
+                break;
+            case TR_QUOT:
+                sp--;
+                sp[-1] = sp[-1] / sp[0];
+                break;
+            case TR_ADD_CONST:
+                sp[-1] = sp[-1] + ins.operand;
+                break;
+            case TR_SUB_CONST:
+                sp[-1] = sp[-1] - ins.operand;
+                break;
+            case TR_MUL_CONST:
+                sp[-1] = sp[-1] * ins.operand;
+                break;
+            case TR_DIV_CONST:
+                sp[-1] = sp[-1] / ins.operand;
+                break;
+            case TR_GUARD_EQ:
+                sp -= 2;
+                if (!(sp[0] == sp[1])) return ins.operand;
+                break;
+            case TR_GUARD_NE:
+                sp -= 2;
+                if (sp[0] == sp[1]) return ins.operand;
+                break;
+            case TR_GUARD_LT:
+                sp -= 2;
+                if (!(sp[0] < sp[1])) return ins.operand;
+                break;
+            case TR_GUARD_GE:
+                sp -= 2;
+                if (sp[0] < sp[1]) return ins.operand;
+                break;
+            case TR_GUARD_GT:
+                sp -= 2;
+                if (!(sp[0] > sp[1])) return ins.operand;
+                break;
+            case TR_GUARD_LE:
+                sp -= 2;
+                if (sp[0] > sp[1]) return ins.operand;
+                break;
+            case TR_PRINT:
+                std::cout << *--sp << std::endl;
+                break;
+            case TR_INPUT:
+                state.setSlotValue(ins.operand, InputStmt::readValue());
+                break;
+            case TR_LOOP:
+                pc = start;
+                break;
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * File: trace.h
+ * -------------
+ * This interface exports the Trace class used by the bytecode VM to
+ * speed up hot loops.  Once a backward jump has been taken often
+ * enough, the VM records the branch decisions of one iteration of the
+ * loop and compiles the path they describe into a linear trace.
+ */
+
+#ifndef _trace_h
+#define _trace_h
+
+#include <utility>
+#include <vector>
+#include "bytecode.hpp"
+#include "evalstate.hpp"
+
+/*
+ * Type: TraceOp
+ * -------------
+ * The instruction set of a compiled trace.  It mirrors OpCode with
+ * three differences: loads carry no definedness check (the trace
+ * checks its inputs once on entry), a constant followed by arithmetic
+ * is fused into one TR_*_CONST instruction, and every conditional
+ * jump becomes a guard on the outcome seen while recording.  A failed
+ * guard leaves the trace at the bytecode index in its operand.
+ */
+
+enum TraceOp {
+    TR_CONST, TR_LOAD, TR_DEFINED, TR_STORE, TR_ASSIGN,
+    TR_ADD, TR_SUB, TR_MUL, TR_DIV, TR_QUOT,
+    TR_ADD_CONST, TR_SUB_CONST, TR_MUL_CONST, TR_DIV_CONST,
+    TR_GUARD_EQ, TR_GUARD_NE, TR_GUARD_LT, TR_GUARD_GE, TR_GUARD_GT, TR_GUARD_LE,
+    TR_PRINT, TR_INPUT, TR_LOOP
+};
+
+struct TraceInstruction {
+    TraceOp op;
+    int operand;
+};
+
+/*
+ * Type: BranchDecision
+ * --------------------
+ * The bytecode index of a jump instruction and whether it was taken.
+ */
+
+typedef std::pair<int, bool> BranchDecision;
+
+/*
+ * Class: Trace
+ * ------------
+ * A compiled loop trace starting at a bytecode index (its head).
+ */
+
+class Trace {
+
+public:
+
+/*
+ * Constructor: Trace
+ * Usage: Trace trace(code, head, decisions);
+ * ------------------------------------------
+ * Compiles the path that starts at head and follows the recorded
+ * branch decisions until it jumps back to head.  If the decisions do
+ * not describe such a path, or the path is too long, isValid returns
+ * false.
+ */
+
+    Trace(const std::vector<Instruction> &code, int head,
+          const std::vector<BranchDecision> &decisions);
+
+/*
+ * Method: isValid
+ * Usage: if (trace.isValid()) . . .
+ * ---------------------------------
+ * Returns true if the trace compiled.
+ */
+
+    bool isValid() const;
+
+/*
+ * Method: canEnter
+ * Usage: if (trace.canEnter(state)) . . .
+ * ---------------------------------------
+ * Returns true if every variable the trace reads before writing it is
+ * defined, which is what allows the trace to drop per-load checks.
+ */
+
+    bool canEnter(const EvalState &state) const;
+
+/*
+ * Method: run
+ * Usage: int pc = trace.run(state, stack);
+ * ----------------------------------------
+ * Runs the trace until a guard fails and returns the bytecode index at
+ * which the interpreter must resume.  Every store goes straight to the
+ * EvalState slots, so the state is consistent at the exit.  The stack
+ * must be at least as deep as the one used for the bytecode.
+ */
+
+    int run(EvalState &state, int *stack) const;
+
+/*
+ * Constant: MAX_LENGTH
+ * --------------------
+ * The longest path, in bytecode instructions, that will be compiled.
+ */
+
+    static const int MAX_LENGTH = 4096;
+
+private:
+
+    std::vector<TraceInstruction> ops;
+    std::vector<int> entrySlots;
+    bool valid = false;
+
+};
+
+#endif
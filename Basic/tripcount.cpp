@@ -0,0 +1,385 @@
+/*
+ * File: tripcount.cpp
+ * -------------------
+ * This file implements the TripCounts class.
+ */
+
+#include "tripcount.hpp"
+#include "closedform.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+/*
+ * Function: findStores
+ * Usage: findStores(exp, stores);
+ * -------------------------------
+ * Counts the variables that the nested assignments in exp assign.
+ */
+
+void findStores(Expression *exp, std::unordered_map<std::string, int> &stores) {
+    if (exp == nullptr || exp->getType() != COMPOUND) return;
+    CompoundExp *compound = (CompoundExp *) exp;
+    if (compound->getOp() == "=" && compound->getLHS()->getType() == IDENTIFIER) {
+        stores[compound->getLHS()->toString()]++;
+    }
+    findStores(compound->getLHS(), stores);
+    findStores(compound->getRHS(), stores);
+}
+
+/*
+ * Function: readsAny
+ * Usage: if (readsAny(exp, stores)) . . .
+ * ---------------------------------------
+ * Returns true if exp reads a variable in stores or assigns anything,
+ * so that it may not have the same value every time.
+ */
+
+bool readsAny(Expression *exp, const std::unordered_map<std::string, int> &stores) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return false;
+        case IDENTIFIER:
+            return stores.count(exp->toString()) != 0;
+        default: {
+            CompoundExp *compound = (CompoundExp *) exp;
+            return compound->getOp() == "=" || readsAny(compound->getLHS(), stores)
+                   || readsAny(compound->getRHS(), stores);
+        }
+    }
+}
+
+/*
+ * Function: countPasses
+ * Usage: TripCountKind kind = countPasses(first, step, relation, limit, count);
+ * ----------------------------------------------------------------------------
+ * Counts the values first, first + step, ... for which the loop stays,
+ * that is, for which value relation limit holds, where relation is
+ * '<', '>', '=' or '!' for "not equal".  The first value for which it
+ * does not hold is the one the loop leaves with, so count is set to
+ * one more.  Returns WRAPS_AROUND if the loop only leaves after the
+ * values wrap around, if at all.
+ */
+
+TripCountKind countPasses(long long first, long long step, char relation, long long limit,
+                          long long &count) {
+    long long stays = 0;
+    switch (relation) {
+        case '<':
+            if (first >= limit) break;
+            if (step < 0) return WRAPS_AROUND;
+            stays = (limit - first + step - 1) / step;
+            if (first + stays * step > INT_MAX) return WRAPS_AROUND;
+            break;
+        case '>':
+            if (first <= limit) break;
+            if (step > 0) return WRAPS_AROUND;
+            stays = (first - limit - step - 1) / -step;
+            if (first + stays * step < INT_MIN) return WRAPS_AROUND;
+            break;
+        case '=':
+            stays = first == limit ? 1 : 0;
+            break;
+        default:
+            if ((limit - first) % step != 0 || (limit - first) / step < 0) {
+                return WRAPS_AROUND;
+            }
+            stays = (limit - first) / step;
+            break;
+    }
+    count = stays + 1;
+    return COUNTED;
+}
+
+}
+
+/*
+ * Implementation notes: TripCounts constructor
+ * --------------------------------------------
+ * The graph only records which innermost loop a block belongs to, so
+ * the body of every loop is collected first by walking up the loop
+ * nesting from each block.
+ */
+
+TripCounts::TripCounts(Program &program, const ExecutionPlan &plan)
+    : plan(plan), cfg(plan.getControlFlowGraph()), constants(program.getConstants(plan)) {
+    for (int block = 0; block < plan.getBlockCount(); block++) {
+        for (int header = cfg.getLoopHeader(block); header != -1;
+             header = cfg.findLoop(header)->parent) {
+            bodies[header].insert(block);
+        }
+    }
+    for (const CFGLoop &loop : cfg.getLoops()) {
+        loops.push_back(analyze(loop));
+    }
+    std::sort(loops.begin(), loops.end(), [](const LoopTripCount &a, const LoopTripCount &b) {
+        return a.header < b.header;
+    });
+}
+
+/*
+ * Implementation notes: analyze
+ * -----------------------------
+ * The ways out of the loop are found as ExecutionPlan::buildBlocks
+ * finds the edges: a GOTO or IF to a missing line raises an error, a
+ * jump to line 0 and falling off the last line leave the program.  A
+ * loop is reported at the line of its header step, which is past the
+ * REM lines a jump back to it may name.  A block
+ * of the loop has a way back to the header, so only an IF can also
+ * lead out of it, and as it ends its block, a step LET in the same
+ * block runs before it.  An IF whose condition ConstantPropagation can
+ * decide, and decides for staying, is not a way out.
+ */
+
+LoopTripCount TripCounts::analyze(const CFGLoop &loop) {
+    LoopTripCount result = {plan.getStep(plan.getBlock(loop.header).first).lineNumber, UNKNOWN,
+                            0};
+    const std::set<int> &body = bodies[loop.header];
+    std::unordered_map<std::string, int> stores;
+    std::unordered_map<std::string, std::pair<int, LetStmt *>> steps;
+    std::vector<Exit> exits;
+    for (int block : body) {
+        const BasicBlock &range = plan.getBlock(block);
+        for (int i = range.first; i <= range.last; i++) {
+            Statement *stmt = plan.getStep(i).stmt;
+            if (stmt == nullptr) continue;
+            switch (stmt->getType()) {
+                case LET: {
+                    LetStmt *let = (LetStmt *) stmt;
+                    stores[let->getVar()]++;
+                    steps[let->getVar()] = {block, let};
+                    findStores(let->getExp(), stores);
+                    break;
+                }
+                case INPUT:
+                    stores[((InputStmt *) stmt)->getVar()]++;
+                    break;
+                case PRINT:
+                    findStores(((PrintStmt *) stmt)->getExp(), stores);
+                    break;
+                case IF:
+                    findStores(((IfStmt *) stmt)->getLHS(), stores);
+                    findStores(((IfStmt *) stmt)->getRHS(), stores);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        const PlanStep &last = plan.getStep(range.last);
+        if (last.stmt == nullptr || last.stmt->getType() != IF) continue;
+        IfStmt *ifStmt = (IfStmt *) last.stmt;
+        bool nextStays = last.next != END_OF_PLAN
+                         && body.count(plan.getBlockOf(last.next)) != 0;
+        bool targetStays = !last.badTarget && last.target != END_OF_PLAN
+                           && body.count(plan.getBlockOf(last.target)) != 0;
+        if (nextStays && targetStays) continue;
+        int lhs, rhs;
+        if (valueOf(ifStmt->getLHS(), lhs) && valueOf(ifStmt->getRHS(), rhs)) {
+            char op = ifStmt->getOp()[0];
+            bool holds = op == '=' ? lhs == rhs : op == '<' ? lhs < rhs : lhs > rhs;
+            if (holds ? targetStays : nextStays) continue;
+        }
+        exits.push_back({block, ifStmt, targetStays});
+    }
+
+    if (exits.empty()) {
+        result.kind = NEVER_EXITS;
+        return result;
+    }
+    bool fixed = true;
+    for (const Exit &exit : exits) {
+        if (readsAny(exit.stmt->getLHS(), stores) || readsAny(exit.stmt->getRHS(), stores)) {
+            fixed = false;
+        }
+    }
+    if (fixed) {
+        result.kind = FIXED_EXITS;
+        return result;
+    }
+    if (exits.size() != 1) return result;
+
+    const Exit &exit = exits[0];
+    Expression *lhs = exit.stmt->getLHS(), *rhs = exit.stmt->getRHS();
+    char op = exit.stmt->getOp()[0];
+    std::string var;
+    Expression *limitExp;
+    if (lhs->getType() == IDENTIFIER && stores.count(lhs->toString())) {
+        var = lhs->toString();
+        limitExp = rhs;
+    } else if (rhs->getType() == IDENTIFIER && stores.count(rhs->toString())) {
+        var = rhs->toString();
+        limitExp = lhs;
+        if (op != '=') op = op == '<' ? '>' : '<';
+    } else {
+        return result;
+    }
+    int step, limit, entry;
+    auto it = steps.find(var);
+    if (stores[var] != 1 || it == steps.end() || !stepOf(it->second.second->getExp(), var, step)
+        || !valueOf(limitExp, limit) || !runsEveryPass(loop, exit.block)
+        || !runsEveryPass(loop, it->second.first) || !findEntryValue(loop, var, entry)) {
+        return result;
+    }
+
+    int stepBlock = it->second.first;
+    bool stepFirst = stepBlock == exit.block || cfg.dominates(stepBlock, exit.block);
+    int first = stepFirst ? (int) ((unsigned) entry + (unsigned) step) : entry;
+
+    char relation;
+    long long bound = limit;
+    if (op == '=') {
+        relation = exit.staysWhenTrue ? '=' : '!';
+    } else if (exit.staysWhenTrue) {
+        relation = op;
+    } else {
+        relation = op == '<' ? '>' : '<';
+        bound += op == '<' ? -1 : 1;
+    }
+    result.kind = countPasses(first, step, relation, bound, result.count);
+    return result;
+}
+
+/*
+ * Implementation notes: runsEveryPass
+ * -----------------------------------
+ * A block that dominates every latch runs on every pass through the
+ * loop.  It runs only once per pass unless control can come back to
+ * it without going through the header, which the search from its
+ * successors rules out.
+ */
+
+bool TripCounts::runsEveryPass(const CFGLoop &loop, int block) {
+    for (int latch : loop.latches) {
+        if (!cfg.dominates(block, latch)) return false;
+    }
+    if (block == loop.header) return true;
+    const std::set<int> &body = bodies[loop.header];
+    std::set<int> seen;
+    std::vector<int> worklist = plan.getBlock(block).successors;
+    while (!worklist.empty()) {
+        int current = worklist.back();
+        worklist.pop_back();
+        if (current == block) return false;
+        if (current == loop.header || body.count(current) == 0
+            || !seen.insert(current).second) {
+            continue;
+        }
+        for (int successor : plan.getBlock(current).successors) {
+            worklist.push_back(successor);
+        }
+    }
+    return true;
+}
+
+/*
+ * Implementation notes: findEntryValue
+ * ------------------------------------
+ * RUN starts at the first block with whatever the variables hold, so
+ * a loop whose header is that block has no known entry value.  Blocks
+ * no path reaches, such as a GOTO that every jump to it now skips,
+ * are not ways in.
+ */
+
+bool TripCounts::findEntryValue(const CFGLoop &loop, const std::string &var, int &value) {
+    if (loop.header == 0) return false;
+    const std::set<int> &body = bodies[loop.header];
+    bool found = false;
+    for (int i = 0; i < cfg.getPredecessorCount(loop.header); i++) {
+        int pred = cfg.getPredecessor(loop.header, i);
+        if (body.count(pred) || !cfg.isReachable(pred)) continue;
+        int entry;
+        if (!findValueBefore(pred, var, entry) || (found && entry != value)) return false;
+        value = entry;
+        found = true;
+    }
+    return found;
+}
+
+/*
+ * Implementation notes: findValueBefore
+ * -------------------------------------
+ * Looks for the last assignment to var on the way to the end of the
+ * block, going back through blocks that have a single reachable
+ * predecessor, which always runs right before them.  Only LET var = exp with a
+ * known value counts; any other assignment to var ends the search.
+ */
+
+bool TripCounts::findValueBefore(int block, const std::string &var, int &value) {
+    std::set<int> seen;
+    while (seen.insert(block).second) {
+        const BasicBlock &range = plan.getBlock(block);
+        for (int i = range.last; i >= range.first; i--) {
+            Statement *stmt = plan.getStep(i).stmt;
+            if (stmt == nullptr) continue;
+            std::unordered_map<std::string, int> stores;
+            switch (stmt->getType()) {
+                case LET:
+                    if (((LetStmt *) stmt)->getVar() == var) {
+                        return valueOf(((LetStmt *) stmt)->getExp(), value);
+                    }
+                    findStores(((LetStmt *) stmt)->getExp(), stores);
+                    break;
+                case INPUT:
+                    if (((InputStmt *) stmt)->getVar() == var) return false;
+                    break;
+                case PRINT:
+                    findStores(((PrintStmt *) stmt)->getExp(), stores);
+                    break;
+                case IF:
+                    findStores(((IfStmt *) stmt)->getLHS(), stores);
+                    findStores(((IfStmt *) stmt)->getRHS(), stores);
+                    break;
+                default:
+                    break;
+            }
+            if (stores.count(var)) return false;
+        }
+        if (block == 0) return false;
+        int pred = -1;
+        for (int i = 0; i < cfg.getPredecessorCount(block); i++) {
+            if (!cfg.isReachable(cfg.getPredecessor(block, i))) continue;
+            if (pred != -1) return false;
+            pred = cfg.getPredecessor(block, i);
+        }
+        block = pred;
+    }
+    return false;
+}
+
+bool TripCounts::valueOf(Expression *exp, int &value) const {
+    if (exp->getType() == CONSTANT) {
+        value = ((ConstantExp *) exp)->getValue();
+        return true;
+    }
+    return constants.lookup(exp, value);
+}
+
+const std::vector<LoopTripCount> &TripCounts::getLoops() const {
+    return loops;
+}
+
+void TripCounts::report(std::ostream &os) const {
+    for (const LoopTripCount &loop : loops) {
+        os << "LINE " << loop.header << ": ";
+        switch (loop.kind) {
+            case COUNTED:
+                os << "LOOP RUNS " << loop.count << (loop.count == 1 ? " TIME" : " TIMES");
+                break;
+            case NEVER_EXITS:
+                os << "LOOP NEVER EXITS";
+                break;
+            case FIXED_EXITS:
+                os << "LOOP EXIT CONDITIONS NEVER CHANGE";
+                break;
+            case WRAPS_AROUND:
+                os << "LOOP COUNTER WRAPS AROUND";
+                break;
+            default:
+                os << "LOOP RUNS AN UNKNOWN NUMBER OF TIMES";
+                break;
+        }
+        os << std::endl;
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * File: tripcount.h
+ * -----------------
+ * This interface exports the TripCounts class, which goes through the
+ * loops of a Program before it runs and works out how many times each
+ * of them goes round, or that it never stops.
+ */
+
+#ifndef _tripcount_h
+#define _tripcount_h
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cfg.hpp"
+#include "constprop.hpp"
+#include "plan.hpp"
+#include "program.hpp"
+
+/*
+ * Type: TripCountKind
+ * -------------------
+ * What the analysis found out about a loop:
+ *
+ *  COUNTED       the loop runs count times each time it is entered
+ *  NEVER_EXITS   no path leads out of the loop, or every test on the
+ *                way out is known never to let control leave
+ *  FIXED_EXITS   every test that could leave the loop compares values
+ *                the loop never changes, so once such a test has let
+ *                control stay, it always will
+ *  WRAPS_AROUND  the loop counts away from its limit or steps over it,
+ *                and only ends, if at all, after the counter wraps
+ *                around the int range
+ *  UNKNOWN       none of the above could be shown
+ */
+
+enum TripCountKind { COUNTED, NEVER_EXITS, FIXED_EXITS, WRAPS_AROUND, UNKNOWN };
+
+/*
+ * Type: LoopTripCount
+ * -------------------
+ * The finding for the loop whose header block starts at line header.
+ * count is only meaningful for COUNTED loops.
+ */
+
+struct LoopTripCount {
+    int header;
+    TripCountKind kind;
+    long long count;
+};
+
+/*
+ * Class: TripCounts
+ * -----------------
+ * The loops are the natural loops of the plan's ControlFlowGraph,
+ * and a loop runs once for every time control reaches its header from
+ * outside or comes back to it.  A loop is counted when it leaves
+ * through a single IF that compares an induction variable with a
+ * value that is the same every time, and that IF and the induction
+ * step LET var = var + c both run once on every pass.  The variable
+ * must be set to a known constant on every path into the loop, and
+ * the limit must be known as well; both come from the program's
+ * ConstantPropagation.
+ *
+ * Runtime errors also end loops, and the analysis does not look for
+ * them: a loop that raises VARIABLE NOT DEFINED on its first pass may
+ * still be reported as never exiting.  Cycles that can be entered at
+ * more than one line are not natural loops and are not reported.
+ */
+
+class TripCounts {
+
+public:
+
+/*
+ * Constructor: TripCounts
+ * Usage: TripCounts tripCounts(program, plan);
+ * --------------------------------------------
+ * Analyzes the loops of program, of which plan is the current plan.
+ */
+
+    TripCounts(Program &program, const ExecutionPlan &plan);
+
+/*
+ * Method: getLoops
+ * Usage: for (const LoopTripCount &loop : tripCounts.getLoops()) . . .
+ * --------------------------------------------------------------------
+ * Returns the findings, one per loop, in the order of the header lines.
+ */
+
+    const std::vector<LoopTripCount> &getLoops() const;
+
+/*
+ * Method: report
+ * Usage: tripCounts.report(std::cout);
+ * ------------------------------------
+ * Writes one line per loop, in program order, in the form
+ * LINE 20: LOOP RUNS 100 TIMES.
+ */
+
+    void report(std::ostream &os) const;
+
+private:
+
+/*
+ * Type: Exit
+ * ----------
+ * An IF that may leave the loop, and whether control stays in the
+ * loop when its condition holds.
+ */
+
+    struct Exit {
+        int block;
+        IfStmt *stmt;
+        bool staysWhenTrue;
+    };
+
+    LoopTripCount analyze(const CFGLoop &loop);
+    bool findEntryValue(const CFGLoop &loop, const std::string &var, int &value);
+    bool findValueBefore(int block, const std::string &var, int &value);
+    bool runsEveryPass(const CFGLoop &loop, int block);
+    bool valueOf(Expression *exp, int &value) const;
+
+    const ExecutionPlan &plan;
+    const ControlFlowGraph &cfg;
+    const ConstantPropagation &constants;
+    std::unordered_map<int, std::set<int>> bodies;
+    std::vector<LoopTripCount> loops;
+
+};
+
+#endif
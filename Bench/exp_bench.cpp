@@ -0,0 +1,93 @@
+/*
+ * File: exp_bench.cpp
+ * -------------------
+ * A microbenchmark that compares evaluating expressions through the
+ * virtual Expression::eval of the parse tree with evaluating the same
+ * expressions through CompiledExp.  Build the exp_bench target and run
+ * it with an optional iteration count:
+ *
+ *     ./exp_bench [iterations]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "../Basic/compiledexp.hpp"
+#include "../Basic/evalstate.hpp"
+#include "../Basic/exp.hpp"
+#include "../Basic/options.hpp"
+#include "../Basic/parser.hpp"
+#include "../Basic/Utils/tokenScanner.hpp"
+
+namespace {
+
+const char *const SHAPES[] = {
+    "X + 1",
+    "I * J",
+    "S + I * I",
+    "(A + B) * (C - 4) / 2",
+    "A * X * X * X + B * X * X + C * X + S - (I - J) * (I + J) / 3",
+};
+
+Expression *parse(const std::string &text) {
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInput(text);
+    return parseExp(scanner);
+}
+
+/*
+ * Function: time
+ * Usage: double ns = time(iterations, fn);
+ * ----------------------------------------
+ * Calls fn iterations times and returns the average nanoseconds per
+ * call.  The results are summed into sink so the loop is not removed.
+ */
+
+template <typename Fn>
+double time(long iterations, Fn fn, int &sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) sink += fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+}
+
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 20000000;
+
+    /* The variables never change, so memos would skip the evaluation. */
+    options.memoization = false;
+    EvalState state;
+    state.setValue("X", 7);
+    state.setValue("I", 12);
+    state.setValue("J", 5);
+    state.setValue("S", 100);
+    state.setValue("A", 3);
+    state.setValue("B", 9);
+    state.setValue("C", 11);
+
+    int sink = 0;
+    std::cout << std::left << std::setw(64) << "expression"
+              << std::right << std::setw(12) << "vtable ns"
+              << std::setw(12) << "compiled ns" << std::setw(10) << "speedup" << std::endl;
+    for (const char *text : SHAPES) {
+        Expression *exp = parse(text);
+        CompiledExp compiled(exp, state);
+        if (compiled.toString(state) != exp->toString()) {
+            std::cerr << "toString mismatch: " << compiled.toString(state) << std::endl;
+            return 1;
+        }
+        double tree = time(iterations, [&] { return exp->eval(state); }, sink);
+        double flat = time(iterations, [&] { return compiled.eval(state); }, sink);
+        std::cout << std::left << std::setw(64) << text << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << tree << std::setw(12) << flat
+                  << std::setw(9) << tree / flat << "x" << std::endl;
+        delete exp;
+    }
+    return sink == 42 ? 1 : 0;
+}
@@ -8,8 +8,8 @@ const string traceFolder = "Test/";
 const string defaultStudentBasic = "./testcode";
 const string defaultStanderBasic = "./Basic-Demo-64bit";
 
-const int traceCount = 100;
-const string traces[100] = {
+const int traceCount = 104;
+const string traces[104] = {
         "trace00.txt", "trace01.txt", "trace02.txt", "trace03.txt", "trace04.txt", "trace05.txt", "trace06.txt",
         "trace07.txt", "trace08.txt", "trace09.txt",
         "trace10.txt", "trace11.txt", "trace12.txt", "trace13.txt", "trace14.txt", "trace15.txt", "trace16.txt",
@@ -30,6 +30,7 @@ const string traces[100] = {
         "trace87.txt", "trace88.txt", "trace89.txt",
         "trace90.txt", "trace91.txt", "trace92.txt", "trace93.txt", "trace94.txt", "trace95.txt", "trace96.txt",
         "trace97.txt", "trace98.txt", "trace99.txt",
+        "trace100.txt", "trace101.txt", "trace102.txt", "trace103.txt",
 };
 
 string studentBasic = "";
@@ -102,22 +103,33 @@ void parseArguments(int argc, char **argv) {
 }
 
 void clearTempFiles() {
-    int r = system("rm test_ans test_out -f");
+    int r = system("rm test_ans test_out test_err -f");
     (void) r;
 }
 
+/*
+ * A trace may come with command line flags in a .args file, its
+ * expected output in a .out file and its expected diagnostics in a .err
+ * file, for behaviour the demo does not have.
+ */
 int testTrace(const char *trace) {
     clearTempFiles();
-    if (system((string() + "cat " + trace + " | timeout 1 " + standerBasic + " > test_ans 2> /dev/null").c_str()) !=
-        0)
+    string stem = string(trace).substr(0, string(trace).rfind('.'));
+    string flags = " $(cat " + stem + ".args 2> /dev/null)";
+    if (system(("test -f " + stem + ".out").c_str()) == 0) {
+        if (system(("cp " + stem + ".out test_ans").c_str()) != 0) return 1;
+    } else if (system((string() + "cat " + trace + " | timeout 1 " + standerBasic + " > test_ans 2> /dev/null").c_str()) !=
+               0)
         return 1;
-    if (system((string() + "cat " + trace + " | timeout 1 " + studentBasic + " > test_out 2> /dev/null").c_str()) !=
+    if (system((string() + "cat " + trace + " | timeout 1 " + studentBasic + flags + " > test_out 2> test_err").c_str()) !=
         0)
         return 2;
     if (system("diff test_ans test_out > /dev/null 2> /dev/null")) return 4;
+    if (system(("test ! -f " + stem + ".err || diff " + stem + ".err test_err > /dev/null 2> /dev/null").c_str()))
+        return 5;
     if (system(
             (string() + "cat " + trace + " | timeout 5 valgrind --error-exitcode=2 --leak-check=full " + studentBasic +
-             " > /dev/null 2> /dev/null").c_str()) != 0)
+             flags + " > /dev/null 2> /dev/null").c_str()) != 0)
         return 3;
     clearTempFiles();
     return 0;
@@ -160,6 +172,19 @@ void runTest(const string currentTrace) {
                     (void) r2;
                     cout << color("\x1b[0m") << endl;
                 }
+                if (error == 5) {
+                    cout << "Expected diagnostics: " << endl << color("\x1b[36m");
+                    cout.flush();
+                    string stem = currentTrace.substr(0, currentTrace.rfind('.'));
+                    int r3 = system(("cat " + stem + ".err").c_str());
+                    (void) r3;
+                    cout << color("\x1b[0m") << endl;
+                    cout << "Your diagnostics: " << endl << color("\x1b[33m");
+                    cout.flush();
+                    int r4 = system("cat test_err");
+                    (void) r4;
+                    cout << color("\x1b[0m") << endl;
+                }
             }
         }
         clearTempFiles();
@@ -183,7 +208,7 @@ int main(int argc, char **argv) {
         /**************************************************************
          if you modify the structure of the files, you should modify the file paths here.
          **************************************************************/
-        system("g++ -o testcode Basic/Basic.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/parser.cpp Basic/program.cpp Basic/statement.cpp Basic/Utils/error.cpp Basic/Utils/error.hpp Basic/Utils/tokenScanner.cpp Basic/Utils/tokenScanner.hpp Basic/Utils/strlib.cpp");
+        system("g++ -o testcode Basic/Basic.cpp Basic/bytecode.cpp Basic/cfg.cpp Basic/closedform.cpp Basic/compiledexp.cpp Basic/constprop.cpp Basic/cppgen.cpp Basic/deadcode.cpp Basic/definite.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/fold.cpp Basic/history.cpp Basic/jit.cpp Basic/loopdetect.cpp Basic/loopopt.cpp Basic/options.cpp Basic/parser.cpp Basic/partial.cpp Basic/plan.cpp Basic/profile.cpp Basic/program.cpp Basic/ranges.cpp Basic/region.cpp Basic/statement.cpp Basic/trace.cpp Basic/tripcount.cpp Basic/Utils/error.cpp Basic/Utils/error.hpp Basic/Utils/tokenScanner.cpp Basic/Utils/tokenScanner.hpp Basic/Utils/strlib.cpp");
         system("chmod +x Basic-Demo-64bit");
         if (traceFile.size()) runTest(traceFile);
         else {
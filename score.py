@@ -3,14 +3,14 @@ import os
 from termcolor import colored
 
 # Step 1: Compile the student's code
-compile_command = "g++ -o testcode Basic/Basic.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/parser.cpp Basic/program.cpp Basic/statement.cpp Basic/Utils/error.cpp Basic/Utils/error.hpp Basic/Utils/tokenScanner.cpp Basic/Utils/tokenScanner.hpp Basic/Utils/strlib.cpp"
+compile_command = "g++ -o testcode Basic/Basic.cpp Basic/bytecode.cpp Basic/cfg.cpp Basic/closedform.cpp Basic/compiledexp.cpp Basic/constprop.cpp Basic/cppgen.cpp Basic/deadcode.cpp Basic/definite.cpp Basic/evalstate.cpp Basic/exp.cpp Basic/fold.cpp Basic/history.cpp Basic/jit.cpp Basic/loopdetect.cpp Basic/loopopt.cpp Basic/options.cpp Basic/parser.cpp Basic/partial.cpp Basic/plan.cpp Basic/profile.cpp Basic/program.cpp Basic/ranges.cpp Basic/region.cpp Basic/statement.cpp Basic/trace.cpp Basic/tripcount.cpp Basic/Utils/error.cpp Basic/Utils/error.hpp Basic/Utils/tokenScanner.cpp Basic/Utils/tokenScanner.hpp Basic/Utils/strlib.cpp"
 subprocess.run(compile_command, shell=True, check=True)
 
 # Constants
 traceFolder = "Test/"
 defaultStudentBasic = "./testcode"
 defaultStandardBasic = "./Basic-Demo-64bit"
-traceCount = 100
+traceCount = 104
 
 # Initialize counters and lists
 total_tests = 0
@@ -27,15 +27,33 @@ for i in range(traceCount):
 
     total_tests += 1
 
+    # A trace may come with command line flags in a .args file, its
+    # expected output in a .out file and its expected diagnostics in a
+    # .err file
+    stem = os.path.splitext(trace_file)[0]
+    flags = []
+    if os.path.exists(stem + ".args"):
+        with open(stem + ".args", 'r') as args_file:
+            flags = args_file.read().split()
+
     # Run student code
     with open(trace_file, 'r') as input_file:
-        student_process = subprocess.run(defaultStudentBasic, stdin=input_file, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+        student_process = subprocess.run([defaultStudentBasic] + flags, stdin=input_file, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
     student_output = student_process.stdout
+    if os.path.exists(stem + ".err"):
+        student_output += student_process.stderr
 
-    # Run standard code
-    with open(trace_file, 'r') as input_file:
-        standard_process = subprocess.run(defaultStandardBasic, stdin=input_file, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
-    standard_output = standard_process.stdout
+    # Run standard code, unless the output is stored
+    if os.path.exists(stem + ".out"):
+        with open(stem + ".out", 'r') as output_file:
+            standard_output = output_file.read()
+        if os.path.exists(stem + ".err"):
+            with open(stem + ".err", 'r') as error_file:
+                standard_output += error_file.read()
+    else:
+        with open(trace_file, 'r') as input_file:
+            standard_process = subprocess.run(defaultStandardBasic, stdin=input_file, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+        standard_output = standard_process.stdout
 
     # Compare outputs
     if student_output != standard_output: